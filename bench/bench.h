@@ -0,0 +1,35 @@
+#ifndef PRASTER_BENCH_H
+#define PRASTER_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace praster::bench {
+
+// Runs the function the given number of times and reports the best wall
+// time in milliseconds.
+template <typename F> double measure(int repetitions, F &&function) {
+  double best = 0.0;
+  for (int i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    double elapsed =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    best = i == 0 ? elapsed : std::min(best, elapsed);
+  }
+  return best;
+}
+
+inline void report(const std::string &name, double milliseconds) {
+  std::cout << std::left << std::setw(48) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(3)
+            << milliseconds << " ms" << std::endl;
+}
+
+} // namespace praster::bench
+
+#endif
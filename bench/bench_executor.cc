@@ -0,0 +1,192 @@
+#include "bench.h"
+#include "executor.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/thread/latch.hpp>
+
+using namespace praster;
+
+namespace {
+
+// Task throughput of a plain boost::asio::thread_pool, as the executor used
+// to be, for comparison.
+class asio_pool {
+public:
+  explicit asio_pool(int num_threads)
+      : m_num_threads(num_threads), m_pool(num_threads) {}
+
+  ~asio_pool() { m_pool.join(); }
+
+  // Posts the tasks and waits for all of them.
+  template <typename F> void run(int count, F &&task) {
+    boost::latch done(count);
+    for (int i = 0; i < count; ++i) {
+      boost::asio::post(m_pool, [&done, &task, i]() {
+        task(i);
+        done.count_down();
+      });
+    }
+    done.wait();
+  }
+
+  template <typename F> void broadcast(F &&task) {
+    run(m_num_threads, task);
+  }
+
+private:
+  int m_num_threads;
+  boost::asio::thread_pool m_pool;
+};
+
+// Busy work of a few hundred nanoseconds per unit.
+double spin(int units) {
+  double x = 1.0;
+  for (int i = 0; i < units * 100; ++i) {
+    x = x * 1.0000001 + 1e-9;
+  }
+  return x;
+}
+
+long long split_sum(executor &exec, long long first, long long last) {
+  if (last - first < 256) {
+    long long sum = 0;
+    for (long long i = first; i <= last; ++i) {
+      sum += i;
+    }
+    return sum;
+  }
+
+  const long long middle = (first + last) / 2;
+  long long left = 0;
+  long long right = 0;
+
+  task_group group(exec);
+  group.run([&](executor::context) {
+    left = split_sum(exec, first, middle);
+  });
+  right = split_sum(exec, middle + 1, last);
+  group.wait();
+  return left + right;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const int num_tasks = argc > 1 ? std::stoi(argv[1]) : 100000;
+  const int num_threads =
+      argc > 2 ? std::stoi(argv[2])
+               : std::max(1u, std::thread::hardware_concurrency());
+  const int supersteps = 10000;
+  const int repetitions = 5;
+  const std::string threads = ", " + std::to_string(num_threads) + " threads";
+
+  executor exec(num_threads);
+  asio_pool pool(num_threads);
+  std::atomic<double> sink{0};
+
+  // empty tasks, all overhead
+
+  bench::report("asio: " + std::to_string(num_tasks) + " empty tasks" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  pool.run(num_tasks, [](int) {});
+                }));
+
+  bench::report("stealing: " + std::to_string(num_tasks) + " empty tasks" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  task_group group(exec);
+                  for (int i = 0; i < num_tasks; ++i) {
+                    group.run([](executor::context) {});
+                  }
+                  group.wait();
+                }));
+
+  // uneven tasks, like tiles of nodata next to dense ones
+
+  const int uneven = num_tasks / 10;
+  auto units = [](int i) { return i % 16 == 0 ? 40 : 1; };
+
+  bench::report("asio: " + std::to_string(uneven) + " uneven tasks" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  pool.run(uneven, [&](int i) { sink = spin(units(i)); });
+                }));
+
+  bench::report("stealing: " + std::to_string(uneven) + " uneven tasks" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  task_group group(exec);
+                  for (int i = 0; i < uneven; ++i) {
+                    group.run([&, i](executor::context) {
+                      sink = spin(units(i));
+                    });
+                  }
+                  group.wait();
+                }));
+
+  // the same uneven work as a loop, under each schedule
+
+  for (const auto &[name, kind] :
+       {std::pair{"fixed", schedule::fixed},
+        std::pair{"dynamic", schedule::dynamic},
+        std::pair{"guided", schedule::guided}}) {
+    bench::report(std::string("parallel_for ") + name + ": " +
+                      std::to_string(uneven) + " uneven" + threads,
+                  bench::measure(repetitions, [&] {
+                    parallel_for(
+                        exec, 0, uneven,
+                        [&](std::size_t i) { sink = spin(units(i)); },
+                        {.kind = kind});
+                  }));
+  }
+
+  // short supersteps, one task per thread each
+
+  bench::report("asio: " + std::to_string(supersteps) + " broadcasts" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  for (int i = 0; i < supersteps; ++i) {
+                    pool.broadcast([](int) {});
+                  }
+                }));
+
+  bench::report("stealing: " + std::to_string(supersteps) + " broadcasts" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  for (int i = 0; i < supersteps; ++i) {
+                    exec.broadcast([](executor::context) {}, true);
+                  }
+                }));
+
+  team region(exec);
+  bench::report("team: " + std::to_string(supersteps) + " supersteps" +
+                    threads,
+                bench::measure(repetitions, [&] {
+                  region.run([&](executor::context) {
+                    for (int i = 0; i < supersteps; ++i) {
+                      region.sync();
+                    }
+                  });
+                }));
+
+  // subtasks spawned recursively, which a queue without helping waits
+  // cannot run at all without blocking its threads
+
+  bench::report("stealing: recursive split" + threads,
+                bench::measure(repetitions, [&] {
+                  task_group group(exec);
+                  group.run([&](executor::context) {
+                    sink = split_sum(exec, 0, 64LL * num_tasks);
+                  });
+                  group.wait();
+                }));
+}
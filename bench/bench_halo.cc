@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "executor.h"
+#include "stripe.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace praster;
+
+int main(int argc, char *argv[]) {
+  const int ds_width = argc > 1 ? std::stoi(argv[1]) : 16384;
+  const int num_threads =
+      argc > 2 ? std::stoi(argv[2])
+               : std::max(1u, std::thread::hardware_concurrency());
+  const int ds_height = 2048;
+  const int stripe_height = 512;
+  const int tile_size = 128;
+  const int repetitions = 5;
+
+  auto reader_callback = [](int x, int y, int width, int height,
+                            double *buffer) {
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[i * width + j] = (y + i) * 7 + x + j;
+      }
+    }
+  };
+
+  std::vector<stripe> stripes;
+  for (int y = 0; y < ds_height; y += stripe_height) {
+    stripes.push_back(stripe::build(y / stripe_height, y, stripe_height,
+                                    ds_width, ds_height, -1.0, tile_size,
+                                    tile_size, reader_callback,
+                                    {.pad_edges = true}));
+  }
+
+  // a writable view marks the interior as changed without touching it, so
+  // that every border is copied again
+
+  auto touch = [&stripes] {
+    for (stripe &s : stripes) {
+      for (tile &t : s.get_tiles()) {
+        t.get_view();
+      }
+    }
+  };
+
+  auto exchange = [&stripes] {
+    for (std::size_t i = 0; i < stripes.size(); ++i) {
+      stripes[i].update_borders(
+          i > 0 ? &stripes[i - 1] : nullptr,
+          i + 1 < stripes.size() ? &stripes[i + 1] : nullptr);
+    }
+  };
+
+  bench::report("update_borders serial", bench::measure(repetitions, [&] {
+                  touch();
+                  exchange();
+                }));
+
+  bench::report("update_borders serial, unchanged",
+                bench::measure(repetitions, exchange));
+
+  executor exec(num_threads);
+  bench::report("update_borders two-phase, " + std::to_string(num_threads) +
+                    " threads",
+                bench::measure(repetitions, [&] {
+                  touch();
+                  stripe::update_borders(stripes, exec);
+                }));
+}
@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "local.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace praster;
+
+template <pixel_type T>
+void run(const std::string &type, int size, int repetitions) {
+  const T nodata = static_cast<T>(-1);
+
+  basic_tile<T> t(0, 0, size, size, 1, 1, 1, 1, nodata);
+  basic_tile<T> other(0, 0, size, size, 1, 1, 1, 1, nodata);
+  t.transform([](int y, int x, T) { return static_cast<T>((y + x) % 97); });
+  other.transform([](int y, int x, T) { return static_cast<T>((y * x) % 89); });
+
+  bench::report(type + " add scalar, transform",
+                bench::measure(repetitions, [&] {
+                  t.transform([nodata](T v) {
+                    return v == nodata ? nodata : static_cast<T>(v + 1);
+                  });
+                }));
+
+  for (local::isa target :
+       {local::isa::scalar, local::isa::avx2, local::isa::avx512}) {
+    if (target > local::supported_isa()) {
+      continue;
+    }
+    local::set_isa(target);
+
+    const std::string suffix = std::string(", ") + local::isa_name(target);
+
+    bench::report(type + " add scalar" + suffix,
+                  bench::measure(repetitions,
+                                 [&] { local::add(t, static_cast<T>(1)); }));
+    bench::report(type + " multiply tile" + suffix,
+                  bench::measure(repetitions,
+                                 [&] { local::multiply(t, other); }));
+    bench::report(type + " clamp" + suffix,
+                  bench::measure(repetitions, [&] {
+                    local::clamp(t, static_cast<T>(10), static_cast<T>(50));
+                  }));
+    bench::report(type + " reclassify (4 rules)" + suffix,
+                  bench::measure(repetitions, [&] {
+                    local::reclassify<T>(t, {{0, 10, 1},
+                                             {10, 20, 2},
+                                             {20, 40, 3},
+                                             {40, 100, 4}});
+                  }));
+  }
+
+  local::set_isa(local::supported_isa());
+}
+
+int main(int argc, char *argv[]) {
+  const int size = argc > 1 ? std::stoi(argv[1]) : 4096;
+  const int repetitions = 5;
+
+  run<std::uint8_t>("uint8", size, repetitions);
+  run<std::int16_t>("int16", size, repetitions);
+  run<float>("float32", size, repetitions);
+  run<double>("float64", size, repetitions);
+}
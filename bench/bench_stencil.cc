@@ -0,0 +1,48 @@
+#include "bench.h"
+#include "tile.h"
+
+#include <string>
+
+using namespace praster;
+
+int main(int argc, char *argv[]) {
+  const int size = argc > 1 ? std::stoi(argv[1]) : 4096;
+  const int repetitions = 5;
+  const double nodata = -1.0;
+
+  // a tile on the dataset edge: no margins with get_neighbours, nodata
+  // padding with the stencil
+
+  tile source = tile(0, 0, size, size, 0, 0, 0, 0, nodata);
+  source.transform([](int y, int x, double) { return (y * 7 + x) % 31; });
+
+  tile padded = tile(0, 0, size, size, 1, 1, 1, 1, nodata);
+  padded.fill(nodata);
+  padded.transform([](int y, int x, double) { return (y * 7 + x) % 31; });
+
+  tile result = tile(0, 0, size, size, 0, 0, 0, 0, nodata);
+
+  bench::report("3x3 mean get_neighbours", bench::measure(repetitions, [&] {
+                  result.transform([&source, nodata](int y, int x, double) {
+                    double sum = source.get_value(y, x);
+                    for (double neighbour : source.get_neighbours(y, x)) {
+                      sum += neighbour == nodata ? 0.0 : neighbour;
+                    }
+                    return sum / 9.0;
+                  });
+                }));
+
+  bench::report("3x3 mean stencil", bench::measure(repetitions, [&] {
+                  padded.stencil<1>(
+                      result, [nodata](const window<double, 1> &w) {
+                        double sum = 0.0;
+                        for (int dy = -1; dy <= 1; ++dy) {
+                          for (int dx = -1; dx <= 1; ++dx) {
+                            const double value = w(dy, dx);
+                            sum += value == nodata ? 0.0 : value;
+                          }
+                        }
+                        return sum / 9.0;
+                      });
+                }));
+}
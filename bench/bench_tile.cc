@@ -0,0 +1,49 @@
+#include "bench.h"
+#include "tile.h"
+
+#include <functional>
+
+using namespace praster;
+
+int main(int argc, char *argv[]) {
+  const int size = argc > 1 ? std::stoi(argv[1]) : 4096;
+  const int repetitions = 5;
+
+  tile t = tile(0, 0, size, size, 1, 1, 1, 1, -1.0);
+  t.transform([](int y, int x, double) { return y + x * 0.5; });
+
+  double sum = 0.0;
+
+  std::function<double(double)> scale = [](double val) {
+    return val * 1.0001 + 0.5;
+  };
+  bench::report("transform std::function",
+                bench::measure(repetitions, [&] { t.transform(scale); }));
+
+  bench::report("transform lambda",
+                bench::measure(repetitions, [&] {
+                  t.transform([](double val) { return val * 1.0001 + 0.5; });
+                }));
+
+  std::function<void(double)> accumulate = [&sum](double val) { sum += val; };
+  bench::report("foreach std::function",
+                bench::measure(repetitions, [&] { t.foreach (accumulate); }));
+
+  bench::report("foreach lambda", bench::measure(repetitions, [&] {
+                  t.foreach ([&sum](double val) { sum += val; });
+                }));
+
+  std::function<double(int, int, double)> offset = [](int y, int x,
+                                                       double val) {
+    return val + y - x;
+  };
+  bench::report("transform (y, x) std::function",
+                bench::measure(repetitions, [&] { t.transform(offset); }));
+
+  bench::report("transform (y, x) lambda", bench::measure(repetitions, [&] {
+                  t.transform(
+                      [](int y, int x, double val) { return val + y - x; });
+                }));
+
+  std::cout << "checksum " << sum << std::endl;
+}
@@ -1,10 +1,65 @@
 #ifndef PRASTER_ALGORITHM_H
 #define PRASTER_ALGORITHM_H
 
+#include <functional>
+
 namespace praster {
-    enum class ScanDirection {
-        LeftToRight
-    } 
+
+class executor;
+
+// Direction in which values flow through a raster scanned cell after cell,
+// such as the passes of a distance transform or of flow accumulation. A
+// cell depends on the cells it follows: the one before it in its row, in
+// its column, or both for the diagonal scans.
+enum class ScanDirection {
+  LeftToRight,
+  RightToLeft,
+  TopToBottom,
+  BottomToTop,
+  TopLeftToBottomRight,
+  TopRightToBottomLeft,
+  BottomLeftToTopRight,
+  BottomRightToTopLeft
+};
+
+// Rows and columns a scan moves by from one cell to the next, each of -1,
+// 0 or 1.
+struct scan_step {
+  int dy;
+  int dx;
+};
+
+inline scan_step get_scan_step(ScanDirection direction) noexcept {
+  switch (direction) {
+  case ScanDirection::LeftToRight:
+    return {0, 1};
+  case ScanDirection::RightToLeft:
+    return {0, -1};
+  case ScanDirection::TopToBottom:
+    return {1, 0};
+  case ScanDirection::BottomToTop:
+    return {-1, 0};
+  case ScanDirection::TopLeftToBottomRight:
+    return {1, 1};
+  case ScanDirection::TopRightToBottomLeft:
+    return {1, -1};
+  case ScanDirection::BottomLeftToTopRight:
+    return {-1, 1};
+  case ScanDirection::BottomRightToTopLeft:
+    return {-1, -1};
+  }
+  return {0, 1};
 }
 
-#endif
\ No newline at end of file
+// Runs the task for every cell of a grid of rows by columns, such as the
+// tiles of a set of stripes, on the threads of the executor in the order
+// of the scan. A cell starts as soon as the cells it follows are done, so
+// a diagonal scan proceeds as a wavefront with no barrier between its
+// diagonals, and the rows of a row scan run side by side. Returns once all
+// are done; the first exception of the task is rethrown.
+void scan_grid(executor &exec, int rows, int columns, ScanDirection direction,
+               const std::function<void(int y_id, int x_id)> &task);
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef PRASTER_ALLOCATOR_H
+#define PRASTER_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace praster {
+
+struct allocator_stats {
+  // bytes handed out to tiles and not returned yet
+  std::size_t current_bytes{0};
+  std::size_t peak_bytes{0};
+
+  // bytes obtained from the system, buffers kept for reuse included
+  std::size_t reserved_bytes{0};
+  std::size_t peak_reserved_bytes{0};
+
+  std::size_t allocations{0};
+  std::size_t reuses{0};
+};
+
+// Source of tile buffers. Every buffer is aligned to a cache line. A buffer
+// must be returned to the allocator it came from, with the size it was
+// requested with. Implementations are thread-safe.
+class buffer_allocator {
+public:
+  static constexpr std::size_t alignment = 64;
+
+  virtual ~buffer_allocator() = default;
+
+  virtual void *allocate(std::size_t bytes) = 0;
+  virtual void deallocate(void *buffer, std::size_t bytes) noexcept = 0;
+
+  virtual allocator_stats get_stats() const = 0;
+};
+
+// Allocates every buffer from the system and frees it on return.
+class aligned_allocator : public buffer_allocator {
+public:
+  void *allocate(std::size_t bytes) override;
+  void deallocate(void *buffer, std::size_t bytes) noexcept override;
+
+  allocator_stats get_stats() const override;
+
+private:
+  mutable std::mutex m_mutex;
+  allocator_stats m_stats;
+};
+
+// Keeps returned buffers in size classes and hands them out again, so that
+// stripes built one after another reuse the memory of the ones released
+// before them instead of going back to the system. Requests are rounded up
+// to the next size class, which wastes at most a quarter of a buffer.
+class pool_allocator : public buffer_allocator {
+public:
+  // Buffers returned while the pool already holds max_pooled_bytes are
+  // freed instead of kept.
+  explicit pool_allocator(std::size_t max_pooled_bytes = SIZE_MAX);
+  ~pool_allocator() override;
+
+  pool_allocator(const pool_allocator &) = delete;
+  pool_allocator &operator=(const pool_allocator &) = delete;
+
+  void *allocate(std::size_t bytes) override;
+  void deallocate(void *buffer, std::size_t bytes) noexcept override;
+
+  allocator_stats get_stats() const override;
+
+  // Returns the bytes currently kept for reuse.
+  std::size_t get_pooled_bytes() const;
+
+  // Frees every buffer kept for reuse.
+  void release();
+
+  static std::size_t size_class(std::size_t bytes) noexcept;
+
+private:
+  std::size_t m_max_pooled_bytes;
+  std::size_t m_pooled_bytes{0};
+  mutable std::mutex m_mutex;
+  allocator_stats m_stats;
+  std::unordered_map<std::size_t, std::vector<void *>> m_free_lists;
+};
+
+// Returns the process-wide allocator used when none is given.
+buffer_allocator *default_allocator() noexcept;
+
+} // namespace praster
+
+#endif
@@ -1,30 +1,244 @@
 #ifndef PRASTER_EXECUTOR_H
 #define PRASTER_EXECUTOR_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <memory>
-
-#include <boost/asio.hpp>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace praster {
 
+// How the threads of an executor are pinned to processors.
+enum class placement {
+  // left to the system, which may move them as it likes
+  none,
+
+  // consecutive threads on the processors of a core, then of a node, for
+  // threads that share data
+  compact,
+
+  // consecutive threads on different cores, and nodes in turn, for
+  // threads that compete for cache and memory bandwidth
+  scatter,
+
+  // on the processors listed in the options, in that order
+  listed
+};
+
+struct executor_options {
+  // Splits the threads among the NUMA nodes of the machine, each pinned to
+  // the processors of its node, so that the memory a task first touches is
+  // local to the threads that later run the tasks of the same node. On a
+  // single node it changes nothing.
+  bool numa_aware{false};
+
+  // Pins every thread to a processor of its own, as long as there are
+  // processors enough, so that the system does not move it and the tiles
+  // it works on stay in its cache. Only the processors of the affinity
+  // mask, and so of the cgroup, are used. With NUMA awareness each thread
+  // gets a processor of its node.
+  placement pinning{placement::none};
+
+  // processors for placement::listed, thread i getting the i-th, the list
+  // taken again from its start if shorter than the threads
+  std::vector<int> cpus{};
+};
+
+// A pool of threads scheduling tasks by work stealing. Every thread keeps
+// a deque of the tasks it submits, running the newest first, and an idle
+// thread steals the oldest task of another, of its own node first. Tasks
+// submitted from outside the pool go to a shared queue. Idle threads spin
+// briefly, then sleep until there is work again.
 class executor {
 public:
   struct context {
     int task_num;
+
+    // node of the thread running the task among those the executor splits
+    // its threads among, counted from 0 for scheduling; always 0 unless
+    // NUMA aware, and not the number the system gives the node
+    int executor_node{0};
+
+    // processor the thread running the task is pinned to, -1 if it is not
+    int cpu{-1};
+
+    // core of that processor, counted from 0 in the order read_cpu_cores
+    // groups the processors of the affinity mask; -1 if not pinned
+    int core{-1};
+
+    // NUMA node of the thread as the system numbers it: that of its
+    // processor if pinned, that of the processors it may run on if they
+    // all lie on one node, -1 otherwise
+    int numa_node{-1};
   };
 
-  explicit executor(int num_threads);
+  // Throws std::invalid_argument if the processors of placement::listed
+  // are missing or outside the affinity mask.
+  explicit executor(int num_threads, const executor_options &options = {});
+
+  // Runs every task submitted so far, and those they submit, before the
+  // threads are stopped.
   ~executor();
 
+  executor(const executor &) = delete;
+  executor &operator=(const executor &) = delete;
+
   int get_num_threads() const;
+
+  // Returns the number of nodes the threads are split among, 1 unless NUMA
+  // aware on a machine with several nodes.
+  int get_num_nodes() const;
+
+  // Runs the task on one of the threads, its task number 0. A task
+  // submitted by a task goes to the deque of the thread running it, and
+  // runs there next unless another thread steals it first.
   void submit(std::function<void(context)> task);
+
+  // Runs a task per thread. A NUMA-aware executor runs the tasks of
+  // consecutive task numbers on the same node, each task always on the
+  // node of its number. Called from a task with blocked set, the thread
+  // runs other tasks while it waits, so that broadcasts can nest.
   void broadcast(std::function<void(context)> task, bool blocked);
 
 private:
+  friend class task_group;
+  friend class team;
+  template <typename R> friend class task_future;
+
+  struct task;
+  struct worker;
+  struct node;
+
+  // Counts down tasks to wait for.
+  struct completion {
+    std::atomic<int> pending{0};
+    std::mutex mutex;
+    std::condition_variable done;
+
+    void finish();
+  };
+
   int m_num_threads;
-  std::unique_ptr<boost::asio::thread_pool> m_thread_pool;
+  std::vector<std::unique_ptr<node>> m_nodes;
+  std::vector<std::unique_ptr<worker>> m_workers;
+
+  // node of every task number
+  std::vector<int> m_task_nodes;
+
+  // tasks submitted from outside the pool
+  std::mutex m_shared_mutex;
+  std::deque<task *> m_shared;
+
+  // queued tasks any thread may take, those of the shared queue and of the
+  // deques, for idle threads to know whether to sleep
+  std::atomic<std::int64_t> m_stealable{0};
+
+  std::atomic<int> m_running{0};
+  std::atomic<bool> m_stopping{false};
+
+  // set while a team holds the threads
+  std::atomic<bool> m_teamed{false};
+
+  // worker of the calling thread, null outside of every executor
+  static thread_local worker *s_current;
+
+  void run_worker(worker &w);
+
+  // Takes a task for the thread, null if there is none it may run.
+  task *find_task(worker &w);
+
+  void run_task(worker &w, task *t);
+
+  // True if the thread may find a task to run.
+  bool has_work(const worker &w) const;
+
+  // Wakes a sleeping thread of the node, or of any node if negative.
+  void wake(int node);
+
+  // Waits for the tasks to finish, running other tasks meanwhile if called
+  // from one of the threads.
+  void wait(completion &c);
+
+  // Runs other tasks until ready returns true, if called from one of the
+  // threads; otherwise returns false at once, for the caller to block.
+  bool help_until(const std::function<bool()> &ready);
+
+  // Returns the worker of the calling thread, if it is one of ours.
+  worker *current_worker() const;
 };
+
+// Tasks, possibly spawning further tasks into the group, waited for all at
+// once. Called from a task, wait runs other tasks until the group is done,
+// so that groups can nest as deep as the recursion of a divide and conquer
+// algorithm goes. The first exception thrown by a task is rethrown by wait.
+class task_group {
+public:
+  explicit task_group(executor &exec);
+
+  // Waits for the tasks still running, dropping their exceptions.
+  ~task_group();
+
+  task_group(const task_group &) = delete;
+  task_group &operator=(const task_group &) = delete;
+
+  void run(std::function<void(executor::context)> task);
+
+  void wait();
+
+private:
+  executor &m_exec;
+  executor::completion m_completion;
+  std::mutex m_error_mutex;
+  std::exception_ptr m_error;
+};
+
+// Every thread of an executor working as one team through a region of
+// many short supersteps, such as an iterative stencil. Rather than a
+// broadcast per superstep, run starts one task per thread for the whole
+// region and the tasks separate the supersteps with sync, a barrier that
+// spins briefly and then blocks. A task keeps its thread and its task
+// number throughout, so its scratch data and the tiles it owns stay in its
+// cache from one superstep to the next.
+class team {
+public:
+  explicit team(executor &exec);
+
+  team(const team &) = delete;
+  team &operator=(const team &) = delete;
+
+  int get_size() const;
+
+  // Runs body on every thread at once, task numbers as broadcast gives
+  // them, and returns once all are done. The first exception thrown by a
+  // body is rethrown here, the other bodies leaving at their next sync.
+  // As the team needs every thread, it cannot be run from a task of its
+  // executor, nor while another team runs there; std::logic_error is
+  // thrown then.
+  void run(const std::function<void(executor::context)> &body);
+
+  // Called by every body the same number of times, returns once all of
+  // them have reached it.
+  void sync();
+
+private:
+  executor &m_exec;
+
+  // on lines of their own, as every thread writes the first and spins on
+  // the second
+  alignas(64) std::atomic<int> m_arrived{0};
+  alignas(64) std::atomic<std::uint32_t> m_generation{0};
+
+  std::atomic<bool> m_failed{false};
+  std::mutex m_error_mutex;
+  std::exception_ptr m_error;
+};
+
 } // namespace praster
 
-#endif
\ No newline at end of file
+#endif
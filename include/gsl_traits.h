@@ -0,0 +1,150 @@
+#ifndef PRASTER_GSL_TRAITS_H
+#define PRASTER_GSL_TRAITS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <gsl/gsl_matrix.h>
+
+namespace praster {
+
+// Maps a pixel type onto the GSL matrix views over a buffer of it. Tiles own
+// their buffers, GSL only ever sees views of them.
+
+template <typename T> struct gsl_traits;
+
+template <> struct gsl_traits<std::uint8_t> {
+  using value_type = std::uint8_t;
+  using matrix = gsl_matrix_uchar;
+  using view = gsl_matrix_uchar_view;
+  using const_view = gsl_matrix_uchar_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_uchar_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_uchar_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+template <> struct gsl_traits<std::int16_t> {
+  using value_type = std::int16_t;
+  using matrix = gsl_matrix_short;
+  using view = gsl_matrix_short_view;
+  using const_view = gsl_matrix_short_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_short_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_short_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+template <> struct gsl_traits<std::uint16_t> {
+  using value_type = std::uint16_t;
+  using matrix = gsl_matrix_ushort;
+  using view = gsl_matrix_ushort_view;
+  using const_view = gsl_matrix_ushort_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_ushort_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_ushort_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+template <> struct gsl_traits<std::int32_t> {
+  using value_type = std::int32_t;
+  using matrix = gsl_matrix_int;
+  using view = gsl_matrix_int_view;
+  using const_view = gsl_matrix_int_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_int_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_int_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+template <> struct gsl_traits<std::uint32_t> {
+  using value_type = std::uint32_t;
+  using matrix = gsl_matrix_uint;
+  using view = gsl_matrix_uint_view;
+  using const_view = gsl_matrix_uint_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_uint_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_uint_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+template <> struct gsl_traits<float> {
+  using value_type = float;
+  using matrix = gsl_matrix_float;
+  using view = gsl_matrix_float_view;
+  using const_view = gsl_matrix_float_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_float_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_float_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+template <> struct gsl_traits<double> {
+  using value_type = double;
+  using matrix = gsl_matrix;
+  using view = gsl_matrix_view;
+  using const_view = gsl_matrix_const_view;
+
+  static inline view view_array_with_tda(value_type *base, std::size_t n1,
+                                         std::size_t n2, std::size_t tda) {
+    return gsl_matrix_view_array_with_tda(base, n1, n2, tda);
+  }
+
+  static inline const_view
+  const_view_array_with_tda(const value_type *base, std::size_t n1,
+                            std::size_t n2, std::size_t tda) {
+    return gsl_matrix_const_view_array_with_tda(base, n1, n2, tda);
+  }
+};
+
+// Pixel types a tile can be instantiated with.
+template <typename T>
+concept pixel_type = requires {
+  typename gsl_traits<T>::matrix;
+};
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef PRASTER_LOCAL_H
+#define PRASTER_LOCAL_H
+
+#include "tile.h"
+
+#include <vector>
+
+namespace praster::local {
+
+// Local (per-cell) map algebra operations over the interior of a tile. Cells
+// holding the nodata value of an operand stay or become nodata. The row
+// kernels are compiled once per instruction set and the widest one supported
+// by the running CPU is picked on first use. Empty tiles are skipped, and so
+// are uniform tiles the operation leaves unchanged.
+
+enum class isa { scalar, avx2, avx512 };
+
+// Returns the widest instruction set supported by both the build and the CPU.
+isa supported_isa() noexcept;
+
+// Returns the instruction set the operations currently dispatch to.
+isa active_isa() noexcept;
+
+// Forces the operations onto the given instruction set. Throws
+// std::invalid_argument if it is wider than supported_isa().
+void set_isa(isa target);
+
+const char *isa_name(isa target) noexcept;
+
+template <pixel_type T> struct reclass_rule {
+  T low;
+  T high;
+  T value;
+};
+
+template <pixel_type T> void add(basic_tile<T> &tile, T value);
+template <pixel_type T> void subtract(basic_tile<T> &tile, T value);
+template <pixel_type T> void multiply(basic_tile<T> &tile, T value);
+
+// Integer results wrap around on overflow, the lowest value of a signed
+// type divided by -1 included. Cells divided by zero become nodata.
+template <pixel_type T> void divide(basic_tile<T> &tile, T value);
+
+// Tile to tile operations require both tiles to have the same interior size
+// and throw std::invalid_argument otherwise.
+
+template <pixel_type T>
+void add(basic_tile<T> &tile, const basic_tile<T> &other);
+template <pixel_type T>
+void subtract(basic_tile<T> &tile, const basic_tile<T> &other);
+template <pixel_type T>
+void multiply(basic_tile<T> &tile, const basic_tile<T> &other);
+template <pixel_type T>
+void divide(basic_tile<T> &tile, const basic_tile<T> &other);
+
+template <pixel_type T> void clamp(basic_tile<T> &tile, T low, T high);
+
+// Cells below the threshold become below, the others become above.
+template <pixel_type T>
+void threshold(basic_tile<T> &tile, T threshold, T below, T above);
+
+// Cells in [low, high) of the first matching rule become its value, cells
+// matching no rule are left unchanged.
+template <pixel_type T>
+void reclassify(basic_tile<T> &tile,
+                const std::vector<reclass_rule<T>> &rules);
+
+// Cells whose counterpart in the mask is nodata become nodata.
+template <pixel_type T>
+void mask(basic_tile<T> &tile, const basic_tile<T> &mask);
+
+} // namespace praster::local
+
+#endif
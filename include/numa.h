@@ -0,0 +1,66 @@
+#ifndef PRASTER_NUMA_H
+#define PRASTER_NUMA_H
+
+#include <string>
+#include <vector>
+
+namespace praster {
+
+// A memory node and the processors closest to it.
+struct numa_node {
+  // as numbered by the system
+  int id;
+  std::vector<int> cpus;
+};
+
+// Parses a Linux cpu list such as "0-3,8,10-11"; entries it cannot parse
+// are skipped.
+std::vector<int> parse_cpu_list(const std::string &list);
+
+// Reads the nodes that have processors from Linux sysfs, in order of id.
+// Without sysfs, or on a machine without NUMA, it returns a single node 0
+// holding every processor this process may run on.
+std::vector<numa_node>
+read_numa_topology(const std::string &node_path = "/sys/devices/system/node");
+
+// Returns the processors this process may run on, as restricted by its
+// affinity mask or cgroup.
+std::vector<int> allowed_cpus();
+
+// Groups the processors by the core they share, hyperthreads of one core
+// together, as Linux sysfs tells. Groups come in order of their first
+// processor; a processor sysfs says nothing of has a core of its own.
+std::vector<std::vector<int>>
+read_cpu_cores(const std::vector<int> &cpus,
+               const std::string &cpu_path = "/sys/devices/system/cpu");
+
+// Orders processors for threads to take in turn, given the cores of every
+// node. Compact fills a core, then a node, before the next, so that
+// consecutive threads share caches.
+std::vector<int>
+compact_order(const std::vector<std::vector<std::vector<int>>> &nodes);
+
+// Scatter takes one processor of every core before any second one, the
+// nodes in turn, so that consecutive threads share as little as they can
+// and each gets as much cache and memory bandwidth.
+std::vector<int>
+scatter_order(const std::vector<std::vector<std::vector<int>>> &nodes);
+
+// Restricts the calling thread to the processors; false if the system
+// refuses, the thread then running wherever it did before.
+bool pin_current_thread(const std::vector<int> &cpus);
+
+// Assigns the index-th of count stripes to one of num_nodes nodes, in
+// contiguous blocks so that neighbouring stripes, which exchange halos,
+// mostly share a node. The same stripe gets the same node on every call,
+// and thus on every pass.
+inline int numa_node_of(int index, int count, int num_nodes) noexcept {
+  if (count <= 0 || num_nodes <= 1) {
+    return 0;
+  }
+  return static_cast<int>(static_cast<long long>(index) * num_nodes / count);
+}
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef PRASTER_PARALLEL_H
+#define PRASTER_PARALLEL_H
+
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace praster {
+
+// How the indices of a parallel loop are handed to the threads.
+enum class schedule {
+  // Each thread takes a fixed share decided up front: one contiguous block,
+  // or chunks dealt round-robin if a chunk size is given. Cheapest, and
+  // balanced as long as every index costs the same.
+  fixed,
+
+  // Threads take the next chunk as they become free, which balances uneven
+  // work such as tiles of nodata next to dense ones.
+  dynamic,
+
+  // As dynamic, the chunks starting large and shrinking with the work left,
+  // down to the chunk size, for fewer grabs than dynamic at the same
+  // balance.
+  guided
+};
+
+struct parallel_options {
+  schedule kind{schedule::dynamic};
+
+  // Indices per chunk, the smallest chunk for guided; zero to pick one
+  // giving each thread about eight chunks.
+  std::size_t chunk{0};
+};
+
+namespace detail {
+
+// Runs body(context, first, last) over chunks of [begin, end) on every
+// thread of the executor, returning once all are done. The first exception
+// thrown stops the chunks not yet handed out and is rethrown.
+template <typename F>
+void run_chunks(executor &exec, std::size_t begin, std::size_t end,
+                const parallel_options &options, F &&body) {
+  if (begin >= end) {
+    return;
+  }
+
+  const std::size_t count = end - begin;
+  const std::size_t threads =
+      static_cast<std::size_t>(std::max(1, exec.get_num_threads()));
+  const std::size_t chunk =
+      options.chunk != 0 ? options.chunk
+                         : std::max<std::size_t>(1, count / (8 * threads));
+
+  std::atomic<std::size_t> next{begin};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto guarded = [&](executor::context ctx, std::size_t first,
+                     std::size_t last) {
+    try {
+      body(ctx, first, last);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      failed = true;
+    }
+  };
+
+  exec.broadcast(
+      [&](executor::context ctx) {
+        const std::size_t task = ctx.task_num;
+
+        if (options.kind == schedule::fixed) {
+          if (options.chunk == 0) {
+            guarded(ctx, begin + count * task / threads,
+                    begin + count * (task + 1) / threads);
+            return;
+          }
+          for (std::size_t first = begin + task * chunk;
+               first < end && !failed; first += threads * chunk) {
+            guarded(ctx, first, std::min(first + chunk, end));
+          }
+          return;
+        }
+
+        if (options.kind == schedule::dynamic) {
+          for (std::size_t first = next.fetch_add(chunk);
+               first < end && !failed; first = next.fetch_add(chunk)) {
+            guarded(ctx, first, std::min(first + chunk, end));
+          }
+          return;
+        }
+
+        // guided: half of the remaining work spread over the threads
+        std::size_t first = next.load();
+        while (first < end && !failed) {
+          const std::size_t size = std::min(
+              end - first, std::max(chunk, (end - first) / (2 * threads)));
+          if (next.compare_exchange_weak(first, first + size)) {
+            guarded(ctx, first, first + size);
+            first = next.load();
+          }
+        }
+      },
+      true);
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace detail
+
+// Calls body(i) for every i in [begin, end) on the threads of the executor
+// and returns once all calls are done. The first exception thrown by the
+// body is rethrown here, indices not handed out yet being skipped.
+template <typename F>
+void parallel_for(executor &exec, std::size_t begin, std::size_t end,
+                  F &&body, const parallel_options &options = {}) {
+  detail::run_chunks(exec, begin, end, options,
+                     [&body](executor::context, std::size_t first,
+                             std::size_t last) {
+                       for (std::size_t i = first; i < last; ++i) {
+                         body(i);
+                       }
+                     });
+}
+
+// Calls body(element) for every element of a random access range, such as
+// the tiles of a stripe or a vector of stripes, as parallel_for does.
+template <typename Range, typename F>
+void parallel_for_each(executor &exec, Range &range, F &&body,
+                       const parallel_options &options = {}) {
+  auto first = std::begin(range);
+  parallel_for(
+      exec, 0, static_cast<std::size_t>(std::distance(first, std::end(range))),
+      [&](std::size_t i) { body(first[i]); }, options);
+}
+
+// Reduces map(i) over [begin, end) with combine, which has to be
+// associative, identity being its neutral element. Every chunk is folded
+// into a partial result of its own by the thread that takes it, and the
+// partials are combined in index order once all are done, so combine need
+// not be commutative and no lock is taken per index. The operands are
+// grouped by chunk, so the rounding of a floating point sum may vary with
+// the schedule, and between runs for guided, whose chunks vary.
+template <typename T, typename M, typename C>
+T parallel_reduce(executor &exec, std::size_t begin, std::size_t end,
+                  T identity, M &&map, C &&combine,
+                  const parallel_options &options = {}) {
+  // the partials of the chunks a thread took, by first index; a cache line
+  // per thread, so that threads do not write to each other's
+  struct alignas(64) partials {
+    std::vector<std::pair<std::size_t, T>> chunks;
+  };
+
+  std::vector<partials> threads(std::max(1, exec.get_num_threads()));
+
+  detail::run_chunks(exec, begin, end, options,
+                     [&](executor::context ctx, std::size_t first,
+                         std::size_t last) {
+                       T value = identity;
+                       for (std::size_t i = first; i < last; ++i) {
+                         value = combine(std::move(value), map(i));
+                       }
+                       threads[ctx.task_num].chunks.emplace_back(
+                           first, std::move(value));
+                     });
+
+  std::vector<std::pair<std::size_t, T>> chunks;
+  for (partials &thread : threads) {
+    std::move(thread.chunks.begin(), thread.chunks.end(),
+              std::back_inserter(chunks));
+  }
+  std::sort(chunks.begin(), chunks.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  T result = std::move(identity);
+  for (auto &chunk : chunks) {
+    result = combine(std::move(result), std::move(chunk.second));
+  }
+  return result;
+}
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef PRASTER_PIPELINE_H
+#define PRASTER_PIPELINE_H
+
+#include "planner.h"
+#include "stripe.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace praster {
+
+struct pipeline_stats {
+  std::size_t stripes{0};
+
+  // most stripes held at once, loading and writing ones included
+  std::size_t peak_resident_stripes{0};
+
+  // the exchanges between neighbouring stripes
+  exchange_stats exchanges{};
+};
+
+// Streams a raster through a rolling window of stripes, from the top of the
+// dataset down, so that rasters larger than memory can be processed with a
+// bounded number of stripes held at once. Every stripe is loaded and
+// prepared, its halo exchanged with both neighbours, computed, written and
+// released:
+//
+//   load and prepare stripe k + 2
+//   compute stripe k, its halos already exchanged with k - 1 and k + 1
+//   write stripe k - 1
+//
+// The halos of two stripes are exchanged once both are prepared and before
+// either is computed, so the margins of a stripe hold what the prepare
+// stage made of its neighbours, never what the compute stage made of them.
+// Without a prepare stage the margins already hold the cells as read.
+template <pixel_type T> class basic_pipeline {
+public:
+  using value_type = T;
+
+  using stripe_type = basic_stripe<T>;
+
+  using read_callback = typename stripe_type::read_callback;
+
+  using write_callback = typename stripe_type::write_callback;
+
+  using stage_callback = std::function<void(stripe_type &stripe)>;
+
+  // The stripes have to cover the dataset from its top down, each starting
+  // where the previous one ends, as plan_partition proposes them. Throws
+  // std::invalid_argument otherwise.
+  basic_pipeline(int ds_width, int ds_height, T nodata, int tile_width,
+                 int tile_height, std::vector<stripe_extent> stripes,
+                 read_callback reader, write_callback writer,
+                 const stripe_options &options = {});
+
+  inline const std::vector<stripe_extent> &get_stripes() const noexcept {
+    return m_stripes;
+  }
+
+  // Runs the stages on every stripe, one after another on this thread.
+  // The prepare stage may be empty. At most three stripes are held at
+  // once; sharing a pool_allocator in the options lets each reuse the
+  // buffers of the ones released before it.
+  pipeline_stats run(const stage_callback &prepare,
+                     const stage_callback &compute);
+
+  // Same as above, the loading and preparing of the stripes ahead and the
+  // writing of the stripes behind running on the executor while this
+  // thread computes, so that the I/O overlaps the computation. The reader,
+  // the writer and the prepare stage are then called from the threads of
+  // the executor, one stripe at a time each, and the compute stage may use
+  // another executor of its own. At most four stripes are held at once.
+  // An exception thrown by any stage is rethrown here once the pending
+  // loads and writes are done.
+  pipeline_stats run(const stage_callback &prepare,
+                     const stage_callback &compute, executor &io);
+
+private:
+  int m_ds_width;
+  int m_ds_height;
+  T m_nodata;
+  int m_tile_width;
+  int m_tile_height;
+  std::vector<stripe_extent> m_stripes;
+  read_callback m_reader;
+  write_callback m_writer;
+  stripe_options m_options;
+
+  // Builds the stripe and runs the prepare stage on it.
+  stripe_type load(std::size_t index, const stage_callback &prepare) const;
+
+  pipeline_stats run(const stage_callback &prepare,
+                     const stage_callback &compute, executor *io);
+};
+
+extern template class basic_pipeline<std::uint8_t>;
+extern template class basic_pipeline<std::int16_t>;
+extern template class basic_pipeline<std::uint16_t>;
+extern template class basic_pipeline<std::int32_t>;
+extern template class basic_pipeline<std::uint32_t>;
+extern template class basic_pipeline<float>;
+extern template class basic_pipeline<double>;
+
+using pipeline = basic_pipeline<double>;
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef PRASTER_PLANNER_H
+#define PRASTER_PLANNER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gsl_traits.h"
+
+namespace praster {
+
+class executor;
+
+// Data cache sizes of a core, in bytes. The shared last level is reported
+// as a whole, not per core.
+struct cache_topology {
+  std::size_t line_bytes{64};
+  std::size_t l1_bytes{32 * 1024};
+  std::size_t l2_bytes{1024 * 1024};
+  std::size_t l3_bytes{8 * 1024 * 1024};
+
+  // false if the sizes above are defaults, the system not telling
+  bool detected{false};
+};
+
+// Reads the data and unified caches of the first processor from Linux
+// sysfs, falling back to the defaults for anything it cannot read.
+cache_topology
+read_cache_topology(const std::string &cache_path =
+                        "/sys/devices/system/cpu/cpu0/cache");
+
+struct stripe_extent {
+  int y;
+  int height;
+};
+
+// A partitioning of a dataset into stripes and tiles, ready to be handed to
+// basic_stripe::build stripe after stripe.
+struct partition_plan {
+  int tile_width{0};
+  int tile_height{0};
+
+  // from the top of the dataset down, each stripe starting where the
+  // previous one ends
+  std::vector<stripe_extent> stripes{};
+
+  // bytes of the front and back buffers of a full tile, margins and row
+  // padding included
+  std::size_t tile_bytes{0};
+
+  std::size_t tile_count{0};
+
+  // why the sizes were chosen, one reason per line
+  std::string explanation{};
+};
+
+// Proposes tiles whose front and back buffers fit in half of the L2 cache,
+// with rows a whole number of cache lines wide, shrunk while there are
+// fewer than four tiles per thread, and stripes that each give every
+// thread four tiles to work on. Throws std::invalid_argument if the dataset
+// cannot be split with the halo at all.
+partition_plan plan_partition(int ds_width, int ds_height,
+                              std::size_t cell_bytes, int halo,
+                              int num_threads, const cache_topology &caches);
+
+// Same as above for the threads of the executor and the caches of this
+// machine.
+partition_plan plan_partition(int ds_width, int ds_height,
+                              std::size_t cell_bytes, int halo,
+                              const executor &exec);
+
+template <pixel_type T>
+inline partition_plan plan_partition(int ds_width, int ds_height, int halo,
+                                     const executor &exec) {
+  return plan_partition(ds_width, ds_height, sizeof(T), halo, exec);
+}
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef PRASTER_STATISTICS_H
+#define PRASTER_STATISTICS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace praster {
+
+// Summary of the cells of a tile, a stripe or a whole raster. Nodata cells
+// are only counted. Blocks of disjoint areas combine with merge.
+template <typename T> struct tile_statistics {
+  std::size_t count{0};
+  std::size_t nodata_count{0};
+  T min{std::numeric_limits<T>::max()};
+  T max{std::numeric_limits<T>::lowest()};
+  double sum{0};
+
+  // Returns the mean of the valid cells, zero if there is none.
+  inline double mean() const noexcept { return count != 0 ? sum / count : 0; }
+
+  inline void merge(const tile_statistics &other) noexcept {
+    count += other.count;
+    nodata_count += other.nodata_count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+  }
+};
+
+} // namespace praster
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef PRASTER_STRIPE_H
 #define PRASTER_STRIPE_H
 
+#include "algorithm.h"
 #include "tile.h"
 
 #include <functional>
@@ -9,8 +10,61 @@
 
 namespace praster {
 
-class stripe {
+class executor;
+
+struct stripe_options {
+  // Width, in cells, of the margins exchanged between neighbouring tiles and
+  // stripes. A halo of n lets a stencil of radius n, or n steps of a radius-1
+  // stencil, run between two exchanges.
+  int halo{1};
+
+  // Gives the tiles along the dataset edges full margins filled with nodata,
+  // so that every tile has a halo on all four sides and stencils need no
+  // edge handling.
+  bool pad_edges{false};
+
+  // Source of the tile buffers, default_allocator() if null. Sharing a
+  // pool_allocator between the stripes processed one after another lets them
+  // reuse each other's buffers. It must outlive the stripes.
+  buffer_allocator *allocator{nullptr};
+
+  // Gives every tile a back buffer, so that iterative stencils can run in
+  // place with basic_stripe::stencil instead of allocating a second set of
+  // tiles per iteration.
+  bool double_buffered{false};
+
+  // Bytes the tiles of a stripe may hold before the least recently used ones
+  // are compressed, see basic_tile::compress; zero for no limit. Tiles are
+  // decompressed again as they are accessed through the stripe.
+  std::size_t memory_budget{0};
+
+  // Reads the whole stripe, with its margin rows, in a single call of the
+  // callback and copies the tiles out of it, instead of one call per tile
+  // reading the shared margins twice. It suits sources where a call costs
+  // more than the cells it reads, at the price of a copy of the stripe held
+  // while it is built.
+  bool coalesced_read{false};
+
+  // NUMA node, as the executor counts them in context::executor_node, whose
+  // threads allocate and first touch the tiles when the stripe is built on a
+  // NUMA-aware executor, and which processes them in the parallel passes
+  // over the stripe; -1 for any thread. numa_node_of keeps every stripe on
+  // the same node pass after pass. Nodes beyond those of the executor wrap
+  // around. Buffers reused from a pool_allocator stay on the node that first
+  // touched them.
+  int numa_node{-1};
+};
+
+template <pixel_type T> class basic_stripe {
 public:
+  using value_type = T;
+
+  using tile_type = basic_tile<T>;
+
+  using read_callback = typename tile_type::read_callback;
+
+  using write_callback = typename tile_type::write_callback;
+
   inline int get_width() const noexcept { return m_width; }
 
   inline int get_height() const noexcept { return m_height; }
@@ -23,49 +77,214 @@ public:
 
   inline int get_bottom_margin() const noexcept { return m_bottom_margin; }
 
+  inline int get_halo() const noexcept { return m_halo; }
+
+  inline bool has_padded_edges() const noexcept { return m_pad_edges; }
+
+  inline buffer_allocator *get_allocator() const noexcept {
+    return m_allocator;
+  }
+
+  inline bool is_double_buffered() const noexcept {
+    return m_double_buffered;
+  }
+
   inline int get_tile_width() const noexcept { return m_tile_width; }
 
   inline int get_tile_height() const noexcept { return m_tile_height; }
 
   inline int get_stripe_number() const noexcept { return m_stripe_number; }
 
-  inline const std::vector<tile> &get_tiles() const noexcept { return m_tiles; }
+  inline int get_numa_node() const noexcept { return m_numa_node; }
+
+  inline T get_nodata() const noexcept { return m_nodata; }
 
-  void update_borders(stripe *upper_stripe, stripe *lower_stripe);
+  inline std::size_t get_memory_budget() const noexcept {
+    return m_memory_budget;
+  }
+
+  // The tiles as they are, some possibly compressed under a memory budget.
+  inline const std::vector<tile_type> &get_tiles() const noexcept {
+    return m_tiles;
+  }
 
-  static stripe
-  build(int partition_number, int y, int height, int ds_width, int ds_height,
-        double nodata, int tile_width, int tile_height,
-        std::function<void(int x, int y, int width, int height, double *buffer)>
-            callback);
+  inline std::vector<tile_type> &get_tiles() noexcept { return m_tiles; }
+
+  // Returns the tile, decompressed, and compresses the least recently used
+  // other tiles while the stripe is over its memory budget. Tiles returned
+  // before may thus be compressed again; fetch them anew before use.
+  tile_type &get_tile(std::size_t index);
+
+  // Compresses every tile, to keep the stripe around between stages.
+  void compress();
+
+  // Returns the bytes held by the tiles, compressed or not.
+  std::size_t get_memory_bytes() const noexcept;
+
+  // Exchanges the halos of the tiles, and with the neighbouring stripes.
+  // Only borders whose source cells changed since they were last copied are
+  // copied again, see basic_tile::update_borders; the stats tell how many.
+  exchange_stats update_borders(basic_stripe *upper_stripe,
+                                basic_stripe *lower_stripe);
+
+  // Exchanges the halos of all tiles of consecutive stripes, each stripe
+  // lying right above the next, on the threads of the executor. The tiles
+  // go through the two phases of basic_tile::update_side_borders, all of
+  // them finishing the first before any starts the second, so that no cell
+  // is read while being written. Compressed tiles are decompressed for the
+  // exchange, and the memory budgets enforced again afterwards. Unchanged
+  // borders are skipped as above. The tiles of a stripe with a NUMA node
+  // are handled by the threads of that node.
+  static exchange_stats update_borders(std::vector<basic_stripe> &stripes,
+                                       executor &exec);
+
+  // Runs the kernel on every tile of consecutive stripes, each stripe lying
+  // right above the next, in the order of the scan, on the threads of the
+  // executor. A tile starts as soon as the tiles it follows in the scan are
+  // done, with no barrier between wavefronts, and its margins are first
+  // filled from those tiles, so that what the kernel computes in one tile
+  // flows into the next, as in flow accumulation. The other margins keep
+  // what they held. Memory budgets are enforced again afterwards.
+  static void scan(std::vector<basic_stripe> &stripes, executor &exec,
+                   ScanDirection direction,
+                   const std::function<void(tile_type &)> &kernel);
+
+  // Runs basic_tile::stencil on every tile, each reading its front buffer
+  // and writing its back buffer before swapping them. The stripe has to be
+  // double buffered and its halo exchanged again before the next pass.
+  template <int R, typename F>
+    requires stencil_kernel<F, T, R>
+  void stencil(F &&kernel) {
+    for (std::size_t i = 0; i < m_tiles.size(); ++i) {
+      resident(i).template stencil<R>(kernel);
+      enforce_budget();
+    }
+  }
+
+  // Merges the statistics of the tiles, see basic_tile::get_statistics.
+  // Those of a whole raster are the merged statistics of its stripes.
+  tile_statistics<T> get_statistics() const;
+
+  // Same as above, the tiles not summarized yet split among the threads of
+  // the executor, those of the node of the stripe if it has one.
+  tile_statistics<T> get_statistics(executor &exec) const;
+
+  // Exchanges the front and back buffers of every tile.
+  void swap_buffers() noexcept;
+
+  // Hands the interior of every tile to the callback, one call per tile.
+  void write(const write_callback &callback) const;
+
+  static basic_stripe build(int partition_number, int y, int height,
+                            int ds_width, int ds_height, T nodata,
+                            int tile_width, int tile_height,
+                            read_callback callback,
+                            const stripe_options &options = {});
+
+  // Same as above, the tiles being read concurrently on the threads of the
+  // executor. The callback is then called from several threads at once,
+  // each call for a different tile, and has to be safe to call that way:
+  // it may only write the buffer it is given, and reads of the same cells,
+  // as neighbouring tiles overlap by their margins, must not interfere. The
+  // threads of an executor last as long as it does, so state such as a
+  // GDAL dataset handle per thread can be kept thread_local. Under a memory
+  // budget, as many tiles as threads are read at a time. An exception
+  // thrown by the callback is rethrown here once the threads are done.
+  // With a NUMA node in the options, only the threads of that node read,
+  // so that the tiles are allocated in its memory.
+  static basic_stripe build(int partition_number, int y, int height,
+                            int ds_width, int ds_height, T nodata,
+                            int tile_width, int tile_height,
+                            read_callback callback, executor &exec,
+                            const stripe_options &options = {});
 
 private:
+  // Where a tile lies, with its margins and the part of them left as
+  // nodata padding along the dataset edges.
+  struct tile_layout {
+    int x;
+    int y;
+    int width;
+    int height;
+    int left_margin;
+    int right_margin;
+    int top_margin;
+    int bottom_margin;
+    int pad_left;
+    int pad_right;
+    int pad_top;
+    int pad_bottom;
+  };
+
   int m_stripe_number;
   int m_y;
   int m_width;
   int m_height;
   int m_top_margin;
   int m_bottom_margin;
-  double m_nodata;
+  int m_halo;
+  bool m_pad_edges;
+  buffer_allocator *m_allocator;
+  bool m_double_buffered;
+  std::size_t m_memory_budget;
+  int m_numa_node;
+  T m_nodata;
   int m_tile_width;
   int m_tile_height;
   int m_tile_xsize{0};
   int m_tile_ysize{0};
-  std::vector<tile> m_tiles;
+  std::vector<tile_type> m_tiles;
   std::vector<int> m_top_margin_indices;
   std::vector<int> m_bottom_margin_indices;
 
-  stripe(
-      int stripe_number, int y, int width, int height, int top_margin,
-      int bottom_margin, double nodata, int tile_width, int tile_height,
-      std::function<void(int x, int y, int width, int height, double *buffer)>
-          callback);
+  // access stamps of the tiles, for the least recently used to be compressed
+  // first
+  std::vector<std::uint64_t> m_last_use;
+  std::uint64_t m_clock{0};
+
+  // Decompresses the tile and stamps it as just used, without enforcing the
+  // budget so that tiles used together stay decompressed.
+  tile_type &resident(std::size_t index);
+
+  // Compresses the least recently used tiles until the stripe fits its
+  // memory budget or only the most recently used tile is left.
+  void enforce_budget();
+
+  // Reads the tiles one after another, or on the threads of the executor
+  // if there is one.
+  basic_stripe(int stripe_number, int y, int width, int height,
+               int top_margin, int bottom_margin, T nodata, int tile_width,
+               int tile_height, read_callback callback,
+               const stripe_options &options, executor *exec);
+
+  static basic_stripe build(int partition_number, int y, int height,
+                            int ds_width, int ds_height, T nodata,
+                            int tile_width, int tile_height,
+                            read_callback callback,
+                            const stripe_options &options, executor *exec);
+
+  // Allocates and reads a tile; safe to call from several threads at once.
+  // Given the stripe window of a coalesced read, m_width cells wide and
+  // starting at the top margin row, the tile copies its rows straight from
+  // it instead of calling the callback.
+  tile_type load_tile(const tile_layout &layout,
+                      const read_callback &callback, const T *window) const;
 
   inline int compute_tile_index(int y_id, int x_id) const noexcept {
     return m_tile_xsize * y_id + x_id;
   }
 };
 
+extern template class basic_stripe<std::uint8_t>;
+extern template class basic_stripe<std::int16_t>;
+extern template class basic_stripe<std::uint16_t>;
+extern template class basic_stripe<std::int32_t>;
+extern template class basic_stripe<std::uint32_t>;
+extern template class basic_stripe<float>;
+extern template class basic_stripe<double>;
+
+using stripe = basic_stripe<double>;
+
 }; // namespace praster
 
 #endif
\ No newline at end of file
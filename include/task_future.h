@@ -0,0 +1,257 @@
+#ifndef PRASTER_TASK_FUTURE_H
+#define PRASTER_TASK_FUTURE_H
+
+#include "executor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace praster {
+
+template <typename R> class task_future;
+
+namespace detail {
+
+// State shared by a task and the futures of its result: a single
+// allocation holding the result, a flag waited on with the atomic wait of
+// the platform, and the callbacks to run once it is set. Unlike a
+// std::promise and its future, no condition variable is created per task.
+template <typename R> struct future_state {
+  using storage = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+  std::atomic<bool> ready{false};
+  std::optional<storage> value;
+  std::exception_ptr error;
+
+  std::mutex mutex;
+  std::vector<std::function<void()>> continuations;
+
+  // Stores what fn returns, or what it throws, and marks the state ready.
+  template <typename F> void fulfil(F &&fn) {
+    try {
+      if constexpr (std::is_void_v<R>) {
+        fn();
+        value.emplace();
+      } else {
+        value.emplace(fn());
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+    finish();
+  }
+
+  void fail(std::exception_ptr e) {
+    error = std::move(e);
+    finish();
+  }
+
+  void finish() {
+    std::vector<std::function<void()>> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ready.store(true);
+      pending.swap(continuations);
+    }
+    ready.notify_all();
+
+    for (std::function<void()> &continuation : pending) {
+      continuation();
+    }
+  }
+
+  // Runs the callback once the state is ready, at once if it already is.
+  void on_ready(std::function<void()> continuation) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!ready.load()) {
+        continuations.push_back(std::move(continuation));
+        return;
+      }
+    }
+    continuation();
+  }
+};
+
+// What a continuation of a task returning R returns.
+template <typename R, typename F> struct continuation_result {
+  using type = std::invoke_result_t<F, const R &>;
+};
+
+template <typename F> struct continuation_result<void, F> {
+  using type = std::invoke_result_t<F>;
+};
+
+} // namespace detail
+
+// The result of a task run on an executor, which async returns. It can be
+// waited for, copied to several consumers, and chained with then, so that
+// work can be joined on one piece at a time rather than by waiting for the
+// whole executor. Called from a task of the same executor, wait and get
+// run other tasks until the result is there, as task_group::wait does.
+template <typename R> class task_future {
+public:
+  using value_type = R;
+
+  task_future() = default;
+
+  task_future(executor &exec, std::shared_ptr<detail::future_state<R>> state)
+      : m_exec(&exec), m_state(std::move(state)) {}
+
+  // False for a default-constructed future.
+  inline bool valid() const noexcept { return m_state != nullptr; }
+
+  inline bool is_ready() const noexcept {
+    return m_state != nullptr && m_state->ready.load();
+  }
+
+  void wait() const {
+    if (m_state == nullptr) {
+      throw std::logic_error("task_future: no state");
+    }
+    if (m_state->ready.load()) {
+      return;
+    }
+
+    detail::future_state<R> &state = *m_state;
+    if (!m_exec->help_until([&state]() { return state.ready.load(); })) {
+      while (!state.ready.load()) {
+        state.ready.wait(false);
+      }
+    }
+  }
+
+  // Waits for the task and returns its result, or rethrows what it threw.
+  // Every copy of the future sees the same result.
+  decltype(auto) get() const {
+    wait();
+    if (m_state->error) {
+      std::rethrow_exception(m_state->error);
+    }
+    if constexpr (!std::is_void_v<R>) {
+      return static_cast<const R &>(*m_state->value);
+    }
+  }
+
+  // Runs fn on the executor once the result is there, passing it the
+  // result unless R is void, and returns the future of what fn returns. If
+  // the task threw, fn is not called and its future holds the same
+  // exception.
+  template <typename F> auto then(F &&fn) const {
+    using U = typename detail::continuation_result<R, F>::type;
+
+    if (m_state == nullptr) {
+      throw std::logic_error("task_future: no state");
+    }
+
+    // the executor and on_ready hold copyable std::functions, so fn is
+    // shared between the copies rather than copied, and called as non-const
+    auto callable = std::make_shared<std::decay_t<F>>(std::forward<F>(fn));
+
+    auto next = std::make_shared<detail::future_state<U>>();
+    m_state->on_ready([exec = m_exec, state = m_state, next, callable]() {
+      exec->submit([state, next, callable](executor::context) {
+        if (state->error) {
+          next->fail(state->error);
+        } else if constexpr (std::is_void_v<R>) {
+          next->fulfil(*callable);
+        } else {
+          next->fulfil([&]() { return (*callable)(*state->value); });
+        }
+      });
+    });
+    return task_future<U>(*m_exec, std::move(next));
+  }
+
+private:
+  template <typename> friend class task_future;
+
+  template <typename T>
+  friend auto when_all(executor &exec,
+                       const std::vector<task_future<T>> &futures);
+
+  executor *m_exec{nullptr};
+  std::shared_ptr<detail::future_state<R>> m_state;
+};
+
+// Runs task(context) on one of the threads of the executor, as
+// executor::submit does, and returns the future of its result.
+template <typename F> auto async(executor &exec, F &&task) {
+  using R = std::invoke_result_t<F, executor::context>;
+
+  // shared rather than copied into the std::function, as then does
+  auto callable = std::make_shared<std::decay_t<F>>(std::forward<F>(task));
+
+  auto state = std::make_shared<detail::future_state<R>>();
+  exec.submit([state, callable](executor::context ctx) {
+    state->fulfil([&]() { return (*callable)(ctx); });
+  });
+  return task_future<R>(exec, std::move(state));
+}
+
+// Returns a future ready once all of the futures are, holding their results
+// in the same order, or nothing for tasks of no result. If any task threw,
+// it holds the exception of the first such future in the order given. No
+// thread blocks meanwhile: the last task to finish completes the future.
+template <typename T>
+auto when_all(executor &exec, const std::vector<task_future<T>> &futures) {
+  using R = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+  auto state = std::make_shared<detail::future_state<R>>();
+  auto left = std::make_shared<std::atomic<std::size_t>>(futures.size() + 1);
+
+  // shared by the callbacks rather than copied into each
+  auto inputs =
+      std::make_shared<std::vector<std::shared_ptr<detail::future_state<T>>>>();
+  inputs->reserve(futures.size());
+  for (const task_future<T> &future : futures) {
+    if (future.m_state == nullptr) {
+      throw std::logic_error("task_future: no state");
+    }
+    inputs->push_back(future.m_state);
+  }
+
+  auto done = [state, left, inputs]() {
+    if (left->fetch_sub(1) != 1) {
+      return;
+    }
+    for (const auto &input : *inputs) {
+      if (input->error) {
+        state->fail(input->error);
+        return;
+      }
+    }
+    state->fulfil([&inputs]() {
+      if constexpr (!std::is_void_v<T>) {
+        std::vector<T> values;
+        values.reserve(inputs->size());
+        for (const auto &input : *inputs) {
+          values.push_back(*input->value);
+        }
+        return values;
+      }
+    });
+  };
+
+  for (const auto &input : *inputs) {
+    input->on_ready(done);
+  }
+  // the count started one higher so that no input completes it early
+  done();
+
+  return task_future<R>(exec, std::move(state));
+}
+
+} // namespace praster
+
+#endif
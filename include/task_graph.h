@@ -0,0 +1,47 @@
+#ifndef PRASTER_TASK_GRAPH_H
+#define PRASTER_TASK_GRAPH_H
+
+#include "executor.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace praster {
+
+// Tasks and the order between them, run on an executor with no barrier
+// other than the dependencies themselves: a task is submitted the moment
+// the last task it depends on finishes, by the thread that finished it, so
+// it usually runs on that thread next, with the data of its predecessor
+// still in cache. A graph can be run any number of times.
+class task_graph {
+public:
+  using task = std::function<void(executor::context)>;
+
+  // Adds a task and returns its id, ids counting from 0.
+  std::size_t add(task t);
+
+  // Makes the task after wait for the task before to finish.
+  void precede(std::size_t before, std::size_t after);
+
+  inline std::size_t size() const noexcept { return m_nodes.size(); }
+
+  // Runs every task and returns once all are done. Once a task throws, the
+  // tasks not started yet are skipped and the first exception is rethrown
+  // here. Throws std::logic_error if the dependencies form a cycle, the
+  // tasks on it never running.
+  void run(executor &exec) const;
+
+private:
+  struct node {
+    task function;
+    std::vector<std::size_t> successors{};
+    int predecessors{0};
+  };
+
+  std::vector<node> m_nodes;
+};
+
+} // namespace praster
+
+#endif
@@ -1,33 +1,129 @@
 #ifndef PRASTER_TILE_H
 #define PRASTER_TILE_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
-#include <gsl/gsl_matrix.h>
+#include "allocator.h"
+#include "gsl_traits.h"
+#include "statistics.h"
+#include "view.h"
+#include "window.h"
 
 namespace praster {
 
-class tile {
+// Kernel concepts accepted by the templated basic_tile::foreach and
+// basic_tile::transform overloads. Any callable satisfying one of them is
+// invoked directly inside the row loop so that it can be inlined and
+// vectorized by the compiler.
+
+template <typename F, typename T>
+concept value_visitor = std::invocable<F, T>;
+
+template <typename F>
+concept index_visitor = std::invocable<F, int, int>;
+
+template <typename F>
+concept pair_index_visitor = std::invocable<F, const std::pair<int, int> &>;
+
+template <typename F, typename T>
+concept value_transformer = std::invocable<F, T> &&
+    std::convertible_to<std::invoke_result_t<F, T>, T>;
+
+template <typename F, typename T>
+concept index_value_transformer = std::invocable<F, int, int, T> &&
+    std::convertible_to<std::invoke_result_t<F, int, int, T>, T>;
+
+template <typename F, typename T>
+concept pair_index_value_transformer =
+    std::invocable<F, const std::pair<int, int> &, T> &&
+    std::convertible_to<
+        std::invoke_result_t<F, const std::pair<int, int> &, T>, T>;
+
+template <typename F, typename T, int R>
+concept stencil_kernel = std::invocable<F, const window<T, R> &> &&
+    std::convertible_to<std::invoke_result_t<F, const window<T, R> &>, T>;
+
+// How a tile stores its cells. Tiles are classified when they are loaded,
+// see basic_tile::compact.
+enum class tile_state {
+  // the cells differ and are all stored
+  mixed,
+  // every cell, margins included, holds the same valid value
+  uniform,
+  // every cell, margins included, is nodata
+  empty
+};
+
+// What a halo exchange did. Tiles only copy the borders of the neighbours
+// that changed since they last copied them, see basic_tile::update_borders,
+// so that iterations converging on a small area exchange little else.
+struct exchange_stats {
+  // tiles taking part in the exchange
+  std::size_t tiles{0};
+  // tiles that copied at least one border
+  std::size_t active_tiles{0};
+  // borders between a tile and one of its neighbours
+  std::size_t edges{0};
+  // borders copied, the others being unchanged
+  std::size_t copied_edges{0};
+
+  inline void merge(const exchange_stats &other) noexcept {
+    tiles += other.tiles;
+    active_tiles += other.active_tiles;
+    edges += other.edges;
+    copied_edges += other.copied_edges;
+  }
+};
+
+template <pixel_type T> class basic_tile {
 public:
-  tile(int x, int y, int width, int height, int left_margin, int right_margin,
-       int top_margin, int bottom_margin, double nodata);
+  using value_type = T;
+
+  using read_callback =
+      std::function<void(int x, int y, int width, int height, T *buffer)>;
+
+  using write_callback = std::function<void(int x, int y, int width,
+                                            int height, const T *buffer)>;
+
+  using view_type = tile_view<T>;
+  using const_view_type = tile_view<const T>;
+
+  // Rows of the buffer, margins included, start on a cache line and are
+  // padded to a whole number of cache lines, see get_stride. The buffer is
+  // taken from the given allocator, or from default_allocator() if it is
+  // null. The allocator must outlive the tile.
+
+  basic_tile(int x, int y, int width, int height, int left_margin,
+             int right_margin, int top_margin, int bottom_margin, T nodata,
+             buffer_allocator *allocator = nullptr);
 
-  tile(int x, int y, int width, int height, int left_margin, int right_margin,
-       int top_margin, int bottom_margin, double nodata,
-       std::function<void(int x, int y, int width, int height, double *buffer)>
-           read_callback);
+  basic_tile(int x, int y, int width, int height, int left_margin,
+             int right_margin, int top_margin, int bottom_margin, T nodata,
+             read_callback callback, buffer_allocator *allocator = nullptr);
 
-  virtual ~tile();
+  virtual ~basic_tile();
 
-  tile(const tile &t) = delete;
-  tile &operator=(tile &other) = delete;
+  basic_tile(const basic_tile &t) = delete;
+  basic_tile &operator=(basic_tile &other) = delete;
 
-  tile(tile &&other) noexcept;
-  tile &operator=(tile &&other) noexcept;
+  basic_tile(basic_tile &&other) noexcept;
+  basic_tile &operator=(basic_tile &&other) noexcept;
 
   static inline std::pair<int, int> construct_index(const int y,
                                                     const int x) noexcept {
@@ -44,22 +140,360 @@ public:
     return index.second;
   }
 
+  // Type-erased overloads, kept for callers holding a std::function. They
+  // forward to the templated kernels below.
+
   void foreach (std::function<void(const std::pair<int, int> &index)> callback);
   void foreach (std::function<void(const int y, const int x)> callback);
-  void foreach (std::function<void(double val)> callback);
+  void foreach (std::function<void(T val)> callback);
 
-  void transform(std::function<double(double val)> callback);
+  void transform(std::function<T(T val)> callback);
+  void transform(std::function<T(const int y, const int x, T val)> callback);
   void transform(
-      std::function<double(const int y, const int x, double val)> callback);
-  void
-  transform(std::function<double(const std::pair<int, int> &index, double val)>
-                callback);
+      std::function<T(const std::pair<int, int> &index, T val)> callback);
+
+  // Inlinable kernels. Lambdas and function objects bind to these overloads
+  // directly, so the per-cell call carries no dispatch cost and the inner loop
+  // runs over a contiguous row of the underlying buffer. Value transformers
+  // are called once for a uniform or empty tile, which is left untouched if
+  // its value maps onto itself.
+
+  template <pair_index_visitor F> void foreach (F &&callback) {
+    make_resident();
+    for (int y = 0; y < m_height; ++y) {
+      for (int x = 0; x < m_width; ++x) {
+        const std::pair<int, int> index = std::make_pair(y, x);
+        callback(index);
+      }
+    }
+  }
+
+  template <index_visitor F> void foreach (F &&callback) {
+    make_resident();
+    for (int y = 0; y < m_height; ++y) {
+      for (int x = 0; x < m_width; ++x) {
+        callback(y, x);
+      }
+    }
+  }
+
+  template <value_visitor<T> F> void foreach (F &&callback) {
+    make_resident();
+    for (int y = 0; y < m_height; ++y) {
+      const T *row = row_data(y);
+      for (int x = 0; x < m_width; ++x) {
+        callback(row[x]);
+      }
+    }
+  }
+
+  template <value_transformer<T> F> void transform(F &&callback) {
+    make_resident();
+    if (is_compact()) {
+      const T value = callback(*m_data);
+      if (value == *m_data) {
+        return;
+      }
+      make_writable();
+      fill_interior(value);
+      return;
+    }
+
+    invalidate_summary();
+    for (int y = 0; y < m_height; ++y) {
+      T *row = row_data(y);
+      for (int x = 0; x < m_width; ++x) {
+        row[x] = callback(row[x]);
+      }
+    }
+  }
+
+  template <index_value_transformer<T> F> void transform(F &&callback) {
+    make_writable();
+    for (int y = 0; y < m_height; ++y) {
+      T *row = row_data(y);
+      for (int x = 0; x < m_width; ++x) {
+        row[x] = callback(y, x, row[x]);
+      }
+    }
+  }
 
-  std::vector<double> to_vector(bool with_border);
+  template <pair_index_value_transformer<T> F> void transform(F &&callback) {
+    make_writable();
+    for (int y = 0; y < m_height; ++y) {
+      T *row = row_data(y);
+      for (int x = 0; x < m_width; ++x) {
+        const std::pair<int, int> index = std::make_pair(y, x);
+        row[x] = callback(index, row[x]);
+      }
+    }
+  }
+
+  // Applies the kernel to the window of radius R around every interior cell
+  // and stores the results in the interior of the destination tile, which
+  // must have the same size. The tile needs margins of at least R cells on
+  // every side, as built by stripe::build with stripe_options::pad_edges, so
+  // that the windows never leave the buffer and need no bounds checks.
+  template <int R, typename F>
+    requires stencil_kernel<F, T, R>
+  void stencil(basic_tile &destination, F &&kernel) const {
+    check_stencil_margins(R);
+
+    if (destination.m_width != m_width || destination.m_height != m_height) {
+      throw std::invalid_argument("tile: destination size differs");
+    }
+
+    assert(&destination != this);
+
+    make_resident();
+
+    // every window of a compact tile is the same
+    if (is_compact()) {
+      const T value = kernel(window<T, R>(row_data(0), 0));
+      if (destination.is_compact() && *destination.m_data == value) {
+        return;
+      }
+      destination.make_writable();
+      destination.fill_interior(value);
+      return;
+    }
+
+    destination.make_writable();
+    apply_stencil<R>(destination.row_data(0), destination.m_stride, kernel);
+  }
+
+  // Applies the kernel like above, reading the front buffer and writing the
+  // interior of the back buffer, then swaps the two so that the results
+  // become the front. Margins of the new front are stale until the next
+  // halo exchange. Throws std::logic_error if the tile has no back buffer.
+  template <int R, typename F>
+    requires stencil_kernel<F, T, R>
+  void stencil(F &&kernel) {
+    check_stencil_margins(R);
+
+    if (!m_back_buffered) {
+      throw std::logic_error("tile: no back buffer");
+    }
+
+    make_resident();
+
+    // a compact tile stays so if its value maps onto itself
+    if (is_compact()) {
+      if (kernel(window<T, R>(row_data(0), 0)) == *m_data) {
+        return;
+      }
+      materialize();
+    }
+
+    invalidate_summary();
+    apply_stencil<R>(m_back_data + m_top_margin * m_stride + m_left_margin,
+                     m_stride, kernel);
+    swap_buffers();
+  }
+
+  // Gives the tile a back buffer, for the in-place stencil above, holding a
+  // copy of the front buffer so that margins never exchanged, such as the
+  // nodata padding along the dataset edges, are the same in both. Does
+  // nothing if the tile already has one. Compact tiles get theirs when they
+  // are materialized.
+  void add_back_buffer();
+
+  inline bool has_back_buffer() const noexcept { return m_back_buffered; }
+
+  // Exchanges the front and back buffers. Both buffers of a compact tile are
+  // the same, so it stays as it is.
+  inline void swap_buffers() noexcept {
+    assert(m_back_buffered);
+    if (!is_compact() && !is_compressed()) {
+      std::swap(m_data, m_back_data);
+      invalidate_summary();
+      invalidate_margins();
+    }
+  }
+
+  // Scans the buffer, margins included, and if every cell holds the same
+  // value releases it, keeping a single row. Otherwise records which
+  // interior cells are valid. Returns whether the tile is compact. Tiles
+  // read through a callback are compacted as they are loaded.
+  bool compact();
+
+  // Gives a compact tile its full buffer back, every cell holding its value.
+  void materialize();
+
+  // Encodes the buffer, margins included, with a fast lossless codec and
+  // releases it, keeping only the encoded bytes; a back buffer is rebuilt
+  // from the front one on decompression. Compact and compressed tiles are
+  // left as they are. Members reading or writing the cells decompress the
+  // tile on access, const ones included, which may do so from several
+  // threads at once; write and to_vector decode into a scratch buffer
+  // instead, leaving the tile compressed.
+  void compress();
 
-  void update_borders(tile *top_left_tile, tile *top_tile, tile *top_right_tile,
-                      tile *left_tile, tile *right_tile, tile *bottom_left_tile,
-                      tile *bottom_tile, tile *bottom_right_tile);
+  void decompress();
+
+  inline bool is_compressed() const noexcept {
+    return m_encoded.load(std::memory_order_acquire);
+  }
+
+  // Returns the bytes the tile holds on to: its buffers, or its encoded
+  // cells when compressed.
+  std::size_t get_memory_bytes() const noexcept;
+
+  inline tile_state get_state() const noexcept { return m_state; }
+
+  inline bool is_compact() const noexcept {
+    return m_state != tile_state::mixed;
+  }
+
+  // Tells whether the interior cell holds a value other than nodata.
+  inline bool is_valid(const int y, const int x) const {
+    if (!m_valid_mask.empty()) {
+      const std::size_t words = (m_width + 63) / 64;
+      return (m_valid_mask[y * words + x / 64] >> (x % 64)) & 1;
+    }
+    return get_value(y, x) != m_nodata;
+  }
+
+  // Tells whether the validity of the interior cells is known without
+  // reading them. The mask recorded by compact is dropped once the interior
+  // is written to.
+  inline bool has_validity_mask() const noexcept {
+    return !m_valid_mask.empty();
+  }
+
+  // Returns the number of interior cells other than nodata.
+  std::size_t count_valid() const;
+
+  // Returns the statistics of the interior, computed in a single pass on
+  // the first request and kept until the interior is written to. Tiles are
+  // summarized as they are loaded, so the first request is usually free.
+  // Concurrent first requests on the same tile are not synchronized.
+  const tile_statistics<T> &get_statistics() const;
+
+  // Calls the callback with the row, the column and the value of every
+  // interior cell other than nodata. Empty tiles are skipped at once, and
+  // runs of nodata cells a word of the validity mask long at a time.
+  template <typename F>
+    requires std::invocable<F, int, int, T>
+  void foreach_valid(F &&callback) const {
+    if (m_state == tile_state::empty) {
+      return;
+    }
+
+    make_resident();
+    const std::size_t words = (m_width + 63) / 64;
+    for (int y = 0; y < m_height; ++y) {
+      const T *row = row_data(y);
+
+      if (m_state == tile_state::uniform) {
+        for (int x = 0; x < m_width; ++x) {
+          callback(y, x, row[x]);
+        }
+      } else if (!m_valid_mask.empty()) {
+        for (std::size_t w = 0; w < words; ++w) {
+          std::uint64_t bits = m_valid_mask[y * words + w];
+          while (bits != 0) {
+            const int x = static_cast<int>(w * 64) + std::countr_zero(bits);
+            callback(y, x, row[x]);
+            bits &= bits - 1;
+          }
+        }
+      } else {
+        for (int x = 0; x < m_width; ++x) {
+          if (row[x] != m_nodata) {
+            callback(y, x, row[x]);
+          }
+        }
+      }
+    }
+  }
+
+  // Returns a view of the interior of the tile, or of the whole buffer if
+  // with_border is set, that reads and writes the cells in place. Mutable
+  // views materialize compact tiles; const views of compact tiles have a row
+  // stride of zero, every row being the same. Writes through a mutable view
+  // are not tracked, fetching it marks the interior as changed: a view kept
+  // across a halo exchange has to be fetched again before it is written
+  // through, or the neighbours keep the margins they copied before.
+  inline view_type get_view(bool with_border = false) {
+    make_writable();
+    if (with_border) {
+      invalidate_margins();
+      return view_type(m_data, m_height + m_top_margin + m_bottom_margin,
+                       m_width + m_left_margin + m_right_margin, m_stride);
+    }
+    return view_type(row_data(0), m_height, m_width, m_stride);
+  }
+
+  inline const_view_type get_view(bool with_border = false) const {
+    make_resident();
+    if (with_border) {
+      return const_view_type(m_data,
+                             m_height + m_top_margin + m_bottom_margin,
+                             m_width + m_left_margin + m_right_margin,
+                             m_stride);
+    }
+    return const_view_type(row_data(0), m_height, m_width, m_stride);
+  }
+
+  // Copies the cells into a new vector, row after row. Prefer get_view
+  // unless the copy has to outlive the tile.
+  std::vector<T> to_vector(bool with_border) const;
+
+  // Sets every cell of the buffer, margins included, to the value.
+  void fill(T value);
+
+  // Reads the given window of the dataset into the matching cells of the
+  // buffer. The window is in dataset coordinates and must lie within the
+  // tile, margins included; cells outside of it are left untouched.
+  void read(const read_callback &callback, int x, int y, int width,
+            int height);
+
+  // Hands the interior of the tile, without margins, to the callback as a
+  // contiguous row-major buffer.
+  void write(const write_callback &callback) const;
+
+  // Fills the margins from the neighbouring tiles, skipping those whose
+  // cells read here did not change since this tile last copied them. Every
+  // write to a tile marks its interior as changed, a mutable view or row
+  // when it is fetched rather than when written through, so views are
+  // fetched again after every exchange; a swap of the buffers or a read
+  // into the margins makes the tile copy every border again.
+  exchange_stats update_borders(basic_tile *top_left_tile, basic_tile *top_tile,
+                                basic_tile *top_right_tile,
+                                basic_tile *left_tile, basic_tile *right_tile,
+                                basic_tile *bottom_left_tile,
+                                basic_tile *bottom_tile,
+                                basic_tile *bottom_right_tile);
+
+  // The two phases of a halo exchange that runs on many tiles at once. The
+  // first fills the left and right margins, interior rows only, from the
+  // tiles on either side. The second fills the top and bottom margins, full
+  // rows, from the tiles above and below, whose side margins the first
+  // filled, so that the corners need no diagonal tiles. Neither phase reads
+  // cells that the same phase writes in another tile. Unchanged borders
+  // are skipped as above, provided every tile taking part called
+  // stamp_interior before the first phase started.
+  exchange_stats update_side_borders(const basic_tile *left_tile,
+                                     const basic_tile *right_tile);
+
+  exchange_stats update_end_borders(const basic_tile *top_tile,
+                                    const basic_tile *bottom_tile);
+
+  // Gives the interior a new version if it changed since the last one.
+  void stamp_interior() const noexcept;
+
+  // Tells whether a compact tile stays compact through both phases above,
+  // receiving only its own value. Others are to be materialized before the
+  // phases start, as a tile must not change its buffer while the neighbours
+  // read it.
+  bool keeps_compact(const basic_tile *top_left_tile,
+                     const basic_tile *top_tile,
+                     const basic_tile *top_right_tile,
+                     const basic_tile *left_tile, const basic_tile *right_tile,
+                     const basic_tile *bottom_left_tile,
+                     const basic_tile *bottom_tile,
+                     const basic_tile *bottom_right_tile) const;
 
   inline int get_x() const noexcept { return m_x; }
 
@@ -77,30 +511,66 @@ public:
 
   inline int get_bottom_margin() const noexcept { return m_bottom_margin; }
 
-  inline int get_nodata() const noexcept { return m_nodata; }
+  inline T get_nodata() const noexcept { return m_nodata; }
+
+  // Tells whether the cells can be accessed in place, which is not the case
+  // for compressed tiles.
+  inline bool has_buffer() const noexcept { return m_data != nullptr; }
+
+  // Returns the distance, in cells, between the starts of two consecutive
+  // rows of the buffer, the back buffer included. It is zero for compact
+  // tiles, whose rows all share the same storage.
+  inline std::size_t get_stride() const noexcept { return m_stride; }
+
+  // Returns a GSL view of the buffer, margins included, for interoperation
+  // with GSL routines. The view is valid as long as the tile is, and is
+  // fetched again after a halo exchange as get_view is. The mutable view
+  // materializes compact tiles, the const one throws std::logic_error for
+  // them.
+  typename gsl_traits<T>::view get_gsl_view();
+  typename gsl_traits<T>::const_view get_gsl_view() const;
 
-  inline bool has_buffer() const noexcept { return m_matrix != nullptr; }
+  inline buffer_allocator *get_allocator() const noexcept {
+    return m_allocator;
+  }
+
+  // Returns the interior cells of row y, without margins, as a contiguous
+  // span. The mutable overload materializes compact tiles; as with get_view,
+  // a span kept across a halo exchange has to be fetched again before it is
+  // written through.
+  inline std::span<T> get_row(const int y) {
+    make_writable();
+    return std::span<T>(row_data(y), m_width);
+  }
+
+  inline std::span<const T> get_row(const int y) const {
+    make_resident();
+    return std::span<const T>(row_data(y), m_width);
+  }
 
-  inline double get_value(const std::pair<int, int> &index) noexcept {
-    return gsl_matrix_get(m_matrix, index.first + m_top_margin,
-                          index.second + m_left_margin);
+  inline T get_value(const std::pair<int, int> &index) const {
+    make_resident();
+    return *cell_data(index.first + m_top_margin,
+                      index.second + m_left_margin);
   }
 
-  inline double get_value(const int y, const int x) noexcept {
-    return gsl_matrix_get(m_matrix, y + m_top_margin, x + m_left_margin);
+  inline T get_value(const int y, const int x) const {
+    make_resident();
+    return *cell_data(y + m_top_margin, x + m_left_margin);
   }
 
-  inline void set_value(const std::pair<int, int> &index, double val) noexcept {
-    gsl_matrix_set(m_matrix, index.first + m_top_margin,
-                   index.second + m_left_margin, val);
+  inline void set_value(const std::pair<int, int> &index, T val) {
+    make_writable();
+    *cell_data(index.first + m_top_margin, index.second + m_left_margin) = val;
   }
 
-  inline void set_value(const int y, const int x, double val) noexcept {
-    gsl_matrix_set(m_matrix, y + m_top_margin, x + m_left_margin, val);
+  inline void set_value(const int y, const int x, T val) {
+    make_writable();
+    *cell_data(y + m_top_margin, x + m_left_margin) = val;
   }
 
-  inline std::array<double, 8> get_neighbours(const int y,
-                                              const int x) noexcept {
+  inline std::array<T, 8> get_neighbours(const int y, const int x) const {
+    make_resident();
 
     // Indices of the returned neighbour array:
     //
@@ -113,45 +583,184 @@ public:
     //          +---+---+---+
     //
 
-    return {
-        (m_top_margin != 0 && m_left_margin != 0)
-            ? gsl_matrix_get(m_matrix, y - 1 + m_top_margin,
-                             x - 1 + m_left_margin)
-            : m_nodata,
-        (m_top_margin != 0)
-            ? gsl_matrix_get(m_matrix, y - 1 + m_top_margin, x + m_left_margin)
-            : m_nodata,
-        (m_top_margin != 0 && m_right_margin != 0)
-            ? gsl_matrix_get(m_matrix, y - 1 + m_top_margin,
-                             x + 1 + m_left_margin)
-            : m_nodata,
-        (m_right_margin != 0)
-            ? gsl_matrix_get(m_matrix, y + m_top_margin, x + 1 + m_left_margin)
-            : m_nodata,
-        (m_bottom_margin != 0 && m_right_margin != 0)
-            ? gsl_matrix_get(m_matrix, y + 1 + m_top_margin,
-                             x + 1 + m_left_margin)
-            : m_nodata,
-        (m_bottom_margin != 0)
-            ? gsl_matrix_get(m_matrix, y + 1 + m_top_margin, x + m_left_margin)
-            : m_nodata,
-        (m_bottom_margin != 0 && m_left_margin != 0)
-            ? gsl_matrix_get(m_matrix, y + 1 + m_top_margin,
-                             x - 1 + m_left_margin)
-            : m_nodata,
-        (m_left_margin != 0)
-            ? gsl_matrix_get(m_matrix, y + m_top_margin, x - 1 + m_left_margin)
-            : m_nodata};
-  }
-
-  inline std::array<double, 8>
-  get_neighbours(const std::pair<int, int> &index) noexcept {
+    return {(m_top_margin != 0 && m_left_margin != 0)
+                ? *cell_data(y - 1 + m_top_margin, x - 1 + m_left_margin)
+                : m_nodata,
+            (m_top_margin != 0)
+                ? *cell_data(y - 1 + m_top_margin, x + m_left_margin)
+                : m_nodata,
+            (m_top_margin != 0 && m_right_margin != 0)
+                ? *cell_data(y - 1 + m_top_margin, x + 1 + m_left_margin)
+                : m_nodata,
+            (m_right_margin != 0)
+                ? *cell_data(y + m_top_margin, x + 1 + m_left_margin)
+                : m_nodata,
+            (m_bottom_margin != 0 && m_right_margin != 0)
+                ? *cell_data(y + 1 + m_top_margin, x + 1 + m_left_margin)
+                : m_nodata,
+            (m_bottom_margin != 0)
+                ? *cell_data(y + 1 + m_top_margin, x + m_left_margin)
+                : m_nodata,
+            (m_bottom_margin != 0 && m_left_margin != 0)
+                ? *cell_data(y + 1 + m_top_margin, x - 1 + m_left_margin)
+                : m_nodata,
+            (m_left_margin != 0)
+                ? *cell_data(y + m_top_margin, x - 1 + m_left_margin)
+                : m_nodata};
+  }
+
+  inline std::array<T, 8>
+  get_neighbours(const std::pair<int, int> &index) const {
 
     return get_neighbours(index.first, index.second);
   }
 
 private:
-  gsl_matrix *m_matrix{nullptr};
+  // Returns the cell at row y and column x of the buffer, margins included.
+  inline T *cell_data(const int y, const int x) const noexcept {
+    assert(m_data != nullptr);
+    return m_data + y * m_stride + x;
+  }
+
+  // Returns the first interior cell of row y, skipping the top and left
+  // margins.
+  inline T *row_data(const int y) const noexcept {
+    return cell_data(y + m_top_margin, m_left_margin);
+  }
+
+  // Copies a height x width block of cells from the source tile's buffer into
+  // this tile's buffer. Coordinates include margins. Returns whether any cell
+  // changed.
+  bool copy_cells(const basic_tile &source, int source_y, int source_x,
+                  int y, int x, int height, int width);
+
+  // Tells whether every cell of a height x width block of the buffer holds
+  // the value. Coordinates include margins.
+  bool holds_only(T value, int y, int x, int height, int width) const;
+
+  // Returns the row stride, in cells, of a buffer the given number of cells
+  // wide.
+  static std::size_t padded_stride(int width) noexcept;
+
+  void check_stencil_margins(int radius) const;
+
+  // Decompresses the tile if it is compressed. Const members call it too,
+  // the buffers being mutable; concurrent callers decode the tile once.
+  inline void make_resident() const {
+    if (is_compressed()) {
+      decode();
+    }
+  }
+
+  void decode() const;
+
+  // Allocates the back buffer as a copy of the front one.
+  void copy_to_back_buffer() const;
+
+  // Prepares the interior for writing: decompresses or materializes the
+  // tile and drops the validity mask and statistics about to go stale.
+  inline void make_writable() {
+    make_resident();
+    if (is_compact()) {
+      materialize();
+    }
+    invalidate_summary();
+  }
+
+  // Sets every interior cell of a writable tile to the value.
+  void fill_interior(T value);
+
+  // Records the validity mask of the interior of a mixed tile.
+  void update_validity_mask();
+
+  // Drops what is known about the interior once it is written to.
+  inline void invalidate_summary() noexcept {
+    m_valid_mask.clear();
+    m_statistics.reset();
+    m_interior_changed = true;
+  }
+
+  // Makes the tile copy every border at the next exchange, and those who
+  // read its margins copy them again, once the margins are overwritten.
+  void invalidate_margins() noexcept;
+
+  // Where the neighbours of a tile lie, indexing the versions of their cells
+  // last copied.
+  enum border {
+    top_left_border,
+    top_border,
+    top_right_border,
+    left_border,
+    right_border,
+    bottom_left_border,
+    bottom_border,
+    bottom_right_border
+  };
+
+  // The versions of the interior and the margins of a neighbour, as far as
+  // its cells read into a border go; zero for never copied.
+  struct border_version {
+    std::uint64_t interior{0};
+    std::uint64_t margins{0};
+
+    bool operator==(const border_version &) const = default;
+  };
+
+  // Copies the block of the source into the border unless it did not change
+  // since the last copy. Updates the stats and returns whether any cell of
+  // this tile changed.
+  bool copy_border(border b, const basic_tile &source,
+                   std::uint64_t source_margins, int source_y, int source_x,
+                   int y, int x, int height, int width, exchange_stats &stats);
+
+  // Summarizes the interior in a single pass of the local kernels.
+  tile_statistics<T> compute_statistics() const;
+
+  // Returns the size, in bytes, of the front buffer.
+  std::size_t buffer_bytes() const noexcept;
+
+  // Runs the stencil over the interior of the front buffer into the cells
+  // starting at target, rows being target_stride cells apart.
+  template <int R, typename F>
+  void apply_stencil(T *target, const std::ptrdiff_t target_stride,
+                     F &kernel) const {
+    const std::ptrdiff_t stride = m_stride;
+    for (int y = 0; y < m_height; ++y) {
+      const T *source = row_data(y);
+      T *target_row = target + y * target_stride;
+      for (int x = 0; x < m_width; ++x) {
+        target_row[x] = kernel(window<T, R>(source + x, stride));
+      }
+    }
+  }
+
+  // Releases the buffers back to their allocator.
+  void free_buffer() noexcept;
+
+  // mutable for const members to decompress the tile on access, under
+  // the lock, whether it is compressed being read without it
+  mutable T *m_data{nullptr};
+  mutable T *m_back_data{nullptr};
+  bool m_back_buffered{false};
+  tile_state m_state{tile_state::mixed};
+  std::vector<std::uint64_t> m_valid_mask;
+  mutable std::vector<std::byte> m_compressed;
+  mutable std::atomic<bool> m_encoded{false};
+  mutable std::mutex m_decode_mutex;
+
+  // computed on first request, see get_statistics
+  mutable std::optional<tile_statistics<T>> m_statistics;
+
+  // Versions of the cells read by the neighbours in an exchange, unique
+  // across all tiles: the interior, stamped lazily after writes, the left
+  // and right margins and the top and bottom ones.
+  mutable bool m_interior_changed{true};
+  mutable std::uint64_t m_interior_version{0};
+  std::uint64_t m_side_version{0};
+  std::uint64_t m_end_version{0};
+  std::array<border_version, 8> m_copied_versions{};
+  std::size_t m_stride{0};
+  buffer_allocator *m_allocator{nullptr};
   int m_x{0};
   int m_y{0};
   int m_width{0};
@@ -160,9 +769,19 @@ private:
   int m_right_margin{0};
   int m_top_margin{0};
   int m_bottom_margin{0};
-  double m_nodata{std::numeric_limits<double>::min()};
+  T m_nodata{std::numeric_limits<T>::min()};
 };
 
+extern template class basic_tile<std::uint8_t>;
+extern template class basic_tile<std::int16_t>;
+extern template class basic_tile<std::uint16_t>;
+extern template class basic_tile<std::int32_t>;
+extern template class basic_tile<std::uint32_t>;
+extern template class basic_tile<float>;
+extern template class basic_tile<double>;
+
+using tile = basic_tile<double>;
+
 } // namespace praster
 
 #endif
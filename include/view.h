@@ -0,0 +1,85 @@
+#ifndef PRASTER_VIEW_H
+#define PRASTER_VIEW_H
+
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+namespace praster {
+
+// Non-owning view of a block of cells stored row by row with a fixed row
+// stride, such as the interior or the whole buffer of a tile. It follows the
+// interface of a rank-2 std::mdspan with a strided layout, so that it can be
+// swapped for one once the standard library provides it. A view is only
+// valid as long as the buffer it points into.
+template <typename T> class tile_view {
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using size_type = std::size_t;
+
+  constexpr tile_view() noexcept = default;
+
+  constexpr tile_view(T *data, size_type rows, size_type columns,
+                      size_type stride) noexcept
+      : m_data(data), m_rows(rows), m_columns(columns), m_stride(stride) {}
+
+  // A view of mutable cells converts to a view of const ones.
+  template <typename U>
+    requires std::convertible_to<U (*)[], T (*)[]>
+  constexpr tile_view(const tile_view<U> &other) noexcept
+      : m_data(other.data_handle()), m_rows(other.extent(0)),
+        m_columns(other.extent(1)), m_stride(other.stride(0)) {}
+
+  static constexpr std::size_t rank() noexcept { return 2; }
+
+  // Returns the number of rows for r = 0 and of columns for r = 1.
+  constexpr size_type extent(const std::size_t r) const noexcept {
+    return r == 0 ? m_rows : m_columns;
+  }
+
+  // Returns the distance, in cells, between consecutive rows for r = 0 and
+  // consecutive columns for r = 1.
+  constexpr size_type stride(const std::size_t r) const noexcept {
+    return r == 0 ? m_stride : 1;
+  }
+
+  constexpr size_type size() const noexcept { return m_rows * m_columns; }
+
+  constexpr bool empty() const noexcept { return size() == 0; }
+
+  // Tells whether the cells are stored back to back, without any gap
+  // between the rows.
+  constexpr bool is_contiguous() const noexcept {
+    return m_stride == m_columns || m_rows <= 1;
+  }
+
+  constexpr T *data_handle() const noexcept { return m_data; }
+
+  constexpr T &operator()(const size_type y, const size_type x) const noexcept {
+    return m_data[y * m_stride + x];
+  }
+
+  constexpr std::span<T> row(const size_type y) const noexcept {
+    return std::span<T>(m_data + y * m_stride, m_columns);
+  }
+
+  // Returns the view of the rows x columns block whose first cell is at row
+  // y and column x of this view.
+  constexpr tile_view subview(const size_type y, const size_type x,
+                              const size_type rows,
+                              const size_type columns) const noexcept {
+    return tile_view(m_data + y * m_stride + x, rows, columns, m_stride);
+  }
+
+private:
+  T *m_data{nullptr};
+  size_type m_rows{0};
+  size_type m_columns{0};
+  size_type m_stride{0};
+};
+
+} // namespace praster
+
+#endif
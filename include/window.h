@@ -0,0 +1,42 @@
+#ifndef PRASTER_WINDOW_H
+#define PRASTER_WINDOW_H
+
+#include <array>
+#include <cstddef>
+
+namespace praster {
+
+// Read-only view of the (2R + 1) x (2R + 1) cells centred on one cell of a
+// tile buffer. Offsets are relative to the centre cell and must lie within
+// [-R, R]; they are not checked, so reading a cell is a single load at a
+// fixed offset.
+template <typename T, int R> class window {
+public:
+  static constexpr int radius = R;
+
+  window(const T *center, std::ptrdiff_t stride) noexcept
+      : m_center(center), m_stride(stride) {}
+
+  inline T operator()(const int dy, const int dx) const noexcept {
+    return m_center[dy * m_stride + dx];
+  }
+
+  inline T center() const noexcept { return *m_center; }
+
+  // Returns the eight adjacent cells in the order used by
+  // basic_tile::get_neighbours.
+  inline std::array<T, 8> neighbours() const noexcept
+    requires(R >= 1)
+  {
+    return {(*this)(-1, -1), (*this)(-1, 0), (*this)(-1, 1), (*this)(0, 1),
+            (*this)(1, 1),   (*this)(1, 0),  (*this)(1, -1), (*this)(0, -1)};
+  }
+
+private:
+  const T *m_center;
+  std::ptrdiff_t m_stride;
+};
+
+} // namespace praster
+
+#endif
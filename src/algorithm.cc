@@ -0,0 +1,39 @@
+#include "algorithm.h"
+#include "task_graph.h"
+
+namespace praster {
+
+void scan_grid(executor &exec, int rows, int columns, ScanDirection direction,
+               const std::function<void(int y_id, int x_id)> &task) {
+  const scan_step step = get_scan_step(direction);
+
+  task_graph graph;
+  for (int y_id = 0; y_id < rows; ++y_id) {
+    for (int x_id = 0; x_id < columns; ++x_id) {
+      graph.add([&task, y_id, x_id](executor::context) { task(y_id, x_id); });
+    }
+  }
+
+  auto inside = [rows, columns](int y_id, int x_id) {
+    return y_id >= 0 && y_id < rows && x_id >= 0 && x_id < columns;
+  };
+
+  // the diagonal neighbour comes before both others, so depending on the
+  // cells before in the row and in the column orders the diagonal too
+
+  for (int y_id = 0; y_id < rows; ++y_id) {
+    for (int x_id = 0; x_id < columns; ++x_id) {
+      const std::size_t id = y_id * columns + x_id;
+      if (step.dy != 0 && inside(y_id - step.dy, x_id)) {
+        graph.precede((y_id - step.dy) * columns + x_id, id);
+      }
+      if (step.dx != 0 && inside(y_id, x_id - step.dx)) {
+        graph.precede(y_id * columns + x_id - step.dx, id);
+      }
+    }
+  }
+
+  graph.run(exec);
+}
+
+} // namespace praster
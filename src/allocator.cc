@@ -0,0 +1,159 @@
+#include "allocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+namespace praster {
+
+namespace {
+
+void *allocate_aligned(std::size_t bytes) {
+  return ::operator new(bytes,
+                        std::align_val_t{buffer_allocator::alignment});
+}
+
+void free_aligned(void *buffer) noexcept {
+  ::operator delete(buffer, std::align_val_t{buffer_allocator::alignment});
+}
+
+void track_allocation(allocator_stats &stats, std::size_t bytes) {
+  stats.current_bytes += bytes;
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.current_bytes);
+  ++stats.allocations;
+}
+
+void track_reservation(allocator_stats &stats, std::size_t bytes) {
+  stats.reserved_bytes += bytes;
+  stats.peak_reserved_bytes =
+      std::max(stats.peak_reserved_bytes, stats.reserved_bytes);
+}
+
+} // namespace
+
+void *aligned_allocator::allocate(std::size_t bytes) {
+  void *buffer = allocate_aligned(bytes);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  track_allocation(m_stats, bytes);
+  track_reservation(m_stats, bytes);
+  return buffer;
+}
+
+void aligned_allocator::deallocate(void *buffer, std::size_t bytes) noexcept {
+  free_aligned(buffer);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.current_bytes -= bytes;
+  m_stats.reserved_bytes -= bytes;
+}
+
+allocator_stats aligned_allocator::get_stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+pool_allocator::pool_allocator(std::size_t max_pooled_bytes)
+    : m_max_pooled_bytes(max_pooled_bytes) {}
+
+pool_allocator::~pool_allocator() { release(); }
+
+std::size_t pool_allocator::size_class(std::size_t bytes) noexcept {
+  // Four classes per power of two: 2^k, 1.25 * 2^k, 1.5 * 2^k and
+  // 1.75 * 2^k, never smaller than a cache line.
+
+  if (bytes <= alignment) {
+    return alignment;
+  }
+
+  const std::size_t power = std::bit_floor(bytes);
+  const std::size_t step = power / 4;
+
+  return power + (bytes - power + step - 1) / step * step;
+}
+
+void *pool_allocator::allocate(std::size_t bytes) {
+  const std::size_t class_bytes = size_class(bytes);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    track_allocation(m_stats, bytes);
+
+    auto it = m_free_lists.find(class_bytes);
+    if (it != m_free_lists.end() && !it->second.empty()) {
+      void *buffer = it->second.back();
+      it->second.pop_back();
+      m_pooled_bytes -= class_bytes;
+      ++m_stats.reuses;
+      return buffer;
+    }
+  }
+
+  void *buffer = nullptr;
+  try {
+    buffer = allocate_aligned(class_bytes);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.current_bytes -= bytes;
+    --m_stats.allocations;
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  track_reservation(m_stats, class_bytes);
+  return buffer;
+}
+
+void pool_allocator::deallocate(void *buffer, std::size_t bytes) noexcept {
+  const std::size_t class_bytes = size_class(bytes);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.current_bytes -= bytes;
+
+    if (m_pooled_bytes + class_bytes <= m_max_pooled_bytes) {
+      try {
+        m_free_lists[class_bytes].push_back(buffer);
+        m_pooled_bytes += class_bytes;
+        return;
+      } catch (...) {
+        // no room to remember the buffer, give it back instead
+      }
+    }
+
+    m_stats.reserved_bytes -= class_bytes;
+  }
+
+  free_aligned(buffer);
+}
+
+allocator_stats pool_allocator::get_stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+std::size_t pool_allocator::get_pooled_bytes() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pooled_bytes;
+}
+
+void pool_allocator::release() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto &[class_bytes, buffers] : m_free_lists) {
+    for (void *buffer : buffers) {
+      free_aligned(buffer);
+    }
+    m_stats.reserved_bytes -= class_bytes * buffers.size();
+  }
+
+  m_free_lists.clear();
+  m_pooled_bytes = 0;
+}
+
+buffer_allocator *default_allocator() noexcept {
+  static aligned_allocator allocator;
+  return &allocator;
+}
+
+} // namespace praster
@@ -0,0 +1,147 @@
+#ifndef PRASTER_CODEC_H
+#define PRASTER_CODEC_H
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace praster::codec {
+
+// Lossless codec for tile buffers. Every cell is XORed with its left
+// neighbour, which zeroes the leading bytes of slowly varying integers and
+// floats alike, the bytes are shuffled into planes, the n-th byte of every
+// cell in the n-th plane, and the planes are run-length encoded. Nodata
+// areas and smooth surfaces shrink to a fraction of their size; noise does
+// not grow by more than one byte in 128.
+
+template <std::size_t Size> struct bits_of;
+template <> struct bits_of<1> { using type = std::uint8_t; };
+template <> struct bits_of<2> { using type = std::uint16_t; };
+template <> struct bits_of<4> { using type = std::uint32_t; };
+template <> struct bits_of<8> { using type = std::uint64_t; };
+
+// PackBits style: a control byte c < 128 is followed by c + 1 literal bytes,
+// one of 128 or more by a single byte repeated c - 125 times.
+
+inline void encode_runs(const std::uint8_t *in, std::size_t n,
+                        std::vector<std::byte> &out) {
+  constexpr std::size_t min_run = 3;
+  constexpr std::size_t max_run = 130;
+  constexpr std::size_t max_literal = 128;
+
+  std::size_t i = 0;
+  while (i < n) {
+    std::size_t j = i + 1;
+    while (j < n && j - i < max_run && in[j] == in[i]) {
+      ++j;
+    }
+
+    if (j - i >= min_run) {
+      out.push_back(std::byte(128 + (j - i - min_run)));
+      out.push_back(std::byte(in[i]));
+      i = j;
+      continue;
+    }
+
+    const std::size_t start = i;
+    while (i < n && i - start < max_literal) {
+      if (i + 2 < n && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+        break;
+      }
+      ++i;
+    }
+
+    out.push_back(std::byte(i - start - 1));
+    const std::size_t offset = out.size();
+    out.resize(offset + i - start);
+    std::memcpy(out.data() + offset, in + start, i - start);
+  }
+}
+
+inline void decode_runs(const std::byte *in, std::size_t n,
+                        std::uint8_t *out, std::size_t out_size) {
+  std::size_t i = 0;
+  std::size_t o = 0;
+  while (i < n) {
+    const std::size_t control = static_cast<std::size_t>(in[i++]);
+    if (control < 128) {
+      const std::size_t length = control + 1;
+      assert(i + length <= n && o + length <= out_size);
+      std::memcpy(out + o, in + i, length);
+      i += length;
+      o += length;
+    } else {
+      const std::size_t length = control - 125;
+      assert(i < n && o + length <= out_size);
+      std::memset(out + o, static_cast<int>(in[i++]), length);
+      o += length;
+    }
+  }
+  assert(o == out_size);
+}
+
+// Encodes rows x columns cells read stride cells apart.
+template <typename T>
+std::vector<std::byte> compress(const T *data, std::size_t rows,
+                                std::size_t columns, std::size_t stride) {
+  using bits = typename bits_of<sizeof(T)>::type;
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  const std::size_t cells = rows * columns;
+  std::vector<std::uint8_t> planes(cells * sizeof(T));
+
+  for (std::size_t y = 0; y < rows; ++y) {
+    const T *row = data + y * stride;
+    bits previous = 0;
+    for (std::size_t x = 0; x < columns; ++x) {
+      const bits value = std::bit_cast<bits>(row[x]);
+      const bits delta = value ^ previous;
+      previous = value;
+
+      const std::size_t cell = y * columns + x;
+      for (std::size_t b = 0; b < sizeof(T); ++b) {
+        planes[b * cells + cell] = static_cast<std::uint8_t>(delta >> (8 * b));
+      }
+    }
+  }
+
+  std::vector<std::byte> result;
+  result.reserve(planes.size() / 8 + 16);
+  encode_runs(planes.data(), planes.size(), result);
+  result.shrink_to_fit();
+  return result;
+}
+
+// Decodes what compress produced for the same shape into rows x columns
+// cells written stride cells apart.
+template <typename T>
+void decompress(const std::vector<std::byte> &encoded, T *data,
+                std::size_t rows, std::size_t columns, std::size_t stride) {
+  using bits = typename bits_of<sizeof(T)>::type;
+
+  const std::size_t cells = rows * columns;
+  std::vector<std::uint8_t> planes(cells * sizeof(T));
+  decode_runs(encoded.data(), encoded.size(), planes.data(), planes.size());
+
+  for (std::size_t y = 0; y < rows; ++y) {
+    T *row = data + y * stride;
+    bits previous = 0;
+    for (std::size_t x = 0; x < columns; ++x) {
+      const std::size_t cell = y * columns + x;
+      bits delta = 0;
+      for (std::size_t b = 0; b < sizeof(T); ++b) {
+        delta |= static_cast<bits>(planes[b * cells + cell]) << (8 * b);
+      }
+      previous ^= delta;
+      row[x] = std::bit_cast<T>(previous);
+    }
+  }
+}
+
+} // namespace praster::codec
+
+#endif
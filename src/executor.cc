@@ -1,60 +1,580 @@
 #include "executor.h"
+#include "numa.h"
+#include "work_deque.h"
 
-#include <iostream>
-
-#include <boost/thread/latch.hpp>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
 namespace praster {
 
-struct latch_wrapper {
-  std::unique_ptr<boost::latch> latch_;
-  bool blocked_;
+namespace {
+
+// failed attempts at finding a task before an idle thread goes to sleep
+constexpr int idle_spins = 64;
+
+// checks of a team barrier before a thread blocks on it, the first ones
+// without yielding its processor
+constexpr int barrier_spins = 1024;
+constexpr int barrier_busy_spins = 64;
+
+// Thrown by team::sync to bodies still running once another has failed.
+struct team_aborted {};
+
+// Returns the processors of every node this process may run on, nodes
+// outside its affinity mask left out, and processors not listed if the
+// options list them.
+std::vector<numa_node> usable_nodes(const executor_options &options) {
+  std::vector<int> allowed = allowed_cpus();
+
+  if (options.pinning == placement::listed) {
+    if (options.cpus.empty()) {
+      throw std::invalid_argument("executor: no processors listed");
+    }
+
+    std::vector<int> listed = options.cpus;
+    std::sort(listed.begin(), listed.end());
+    listed.erase(std::unique(listed.begin(), listed.end()), listed.end());
+    for (int cpu : listed) {
+      if (!std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+        throw std::invalid_argument("executor: processor " +
+                                    std::to_string(cpu) + " not allowed");
+      }
+    }
+    allowed = std::move(listed);
+  }
 
-  latch_wrapper(bool blocked, size_t num_threads) : blocked_(blocked) {
-    if (blocked) {
-      latch_ = std::make_unique<boost::latch>(num_threads);
+  std::vector<numa_node> nodes;
+  for (const numa_node &node : read_numa_topology()) {
+    std::vector<int> cpus;
+    std::set_intersection(node.cpus.begin(), node.cpus.end(),
+                          allowed.begin(), allowed.end(),
+                          std::back_inserter(cpus));
+    if (!cpus.empty()) {
+      nodes.push_back({.id = node.id, .cpus = std::move(cpus)});
     }
   }
+  return nodes;
+}
+
+// Returns the processors, of the given nodes, for the threads of an
+// executor node to take in turn; none if they are not pinned.
+std::vector<int> pinning_order(const executor_options &options,
+                               const std::vector<numa_node> &nodes) {
+  if (options.pinning == placement::none) {
+    return {};
+  }
 
-  void count_down() {
-    if (blocked_) {
-      latch_->count_down();
+  if (options.pinning == placement::listed) {
+    std::vector<int> order;
+    for (int cpu : options.cpus) {
+      for (const numa_node &node : nodes) {
+        if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) {
+          order.push_back(cpu);
+        }
+      }
     }
+    return order;
+  }
+
+  std::vector<std::vector<std::vector<int>>> cores;
+  for (const numa_node &node : nodes) {
+    cores.push_back(read_cpu_cores(node.cpus));
   }
+  return options.pinning == placement::compact ? compact_order(cores)
+                                                : scatter_order(cores);
+}
 
-  void wait() {
-    if (blocked_) {
-      latch_->wait();
+// Returns the index of the core holding the processor, -1 if none does.
+int core_of(const std::vector<std::vector<int>> &cores, int cpu) {
+  for (std::size_t i = 0; i < cores.size(); ++i) {
+    if (std::binary_search(cores[i].begin(), cores[i].end(), cpu)) {
+      return static_cast<int>(i);
     }
   }
+  return -1;
+}
+
+// Returns the system number of the node holding the processor or, for a
+// thread not pinned, of the only node it may run on; -1 if there is none.
+int system_node_of(const std::vector<numa_node> &nodes, int cpu) {
+  if (cpu < 0) {
+    return nodes.size() == 1 ? nodes.front().id : -1;
+  }
+  for (const numa_node &node : nodes) {
+    if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) {
+      return node.id;
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+struct executor::task {
+  std::function<void(context)> function;
+  int task_num;
+  completion *done;
+};
+
+struct executor::worker {
+  executor *owner;
+  int index;
+  int node;
+
+  // processor the thread is pinned to, its core and the system number of
+  // its node, as the context tells them
+  int cpu;
+  int core;
+  int numa_node;
+
+  work_deque<task> deque{};
+  std::uint32_t seed;
+  std::thread thread{};
 };
 
-executor::executor(int num_threads) : m_num_threads(num_threads) {
-  m_thread_pool = std::make_unique<boost::asio::thread_pool>(m_num_threads);
+struct executor::node {
+  // processors the threads are pinned to; empty if they are not
+  std::vector<int> cpus;
+  std::vector<worker *> workers;
+
+  // broadcast tasks, which only the threads of the node may run
+  std::mutex pinned_mutex;
+  std::deque<task *> pinned;
+  std::atomic<std::int64_t> pinned_count{0};
+
+  std::mutex sleep_mutex;
+  std::condition_variable sleep;
+  std::atomic<int> sleepers{0};
+  int wakeups{0};
+};
+
+thread_local executor::worker *executor::s_current = nullptr;
+
+void executor::completion::finish() {
+  // under the lock, so that a waiter seeing no task pending can no longer
+  // be raced by the last one still touching the completion
+  std::lock_guard<std::mutex> lock(mutex);
+  if (pending.fetch_sub(1) == 1) {
+    done.notify_all();
+  }
+}
+
+executor::executor(int num_threads, const executor_options &options)
+    : m_num_threads(num_threads), m_task_nodes(num_threads, 0) {
+  std::vector<numa_node> nodes;
+  if (options.numa_aware || options.pinning != placement::none) {
+    nodes = usable_nodes(options);
+  }
+
+  // the machine nodes every node of the executor spans, one each if NUMA
+  // aware, all of them as one otherwise
+  std::vector<std::vector<numa_node>> spans;
+  if (options.numa_aware) {
+    // fewer threads than nodes leave the last nodes unused
+    if (static_cast<int>(nodes.size()) > m_num_threads) {
+      nodes.resize(std::max(m_num_threads, 1));
+    }
+    for (const numa_node &node : nodes) {
+      spans.push_back({node});
+    }
+  }
+
+  // on a single node the threads are left where the system puts them,
+  // unless pinned one by one
+  if (spans.size() <= 1) {
+    spans.assign(1, nodes);
+  }
+
+  const int num_nodes = static_cast<int>(spans.size());
+  std::vector<std::vector<int>> orders;
+  for (int n = 0; n < num_nodes; ++n) {
+    m_nodes.push_back(std::make_unique<node>());
+    if (num_nodes > 1) {
+      m_nodes.back()->cpus = spans[n].front().cpus;
+    }
+    orders.push_back(pinning_order(options, spans[n]));
+  }
+
+  // cores numbered over the whole affinity mask, whatever the list
+  std::vector<std::vector<int>> cores;
+  if (options.pinning != placement::none) {
+    cores = read_cpu_cores(allowed_cpus());
+  }
+
+  // consecutive task numbers share a node, the threads split evenly
+
+  for (int i = 0; i < m_num_threads; ++i) {
+    const int n = i * num_nodes / m_num_threads;
+    m_task_nodes[i] = n;
+
+    const std::vector<int> &order = orders[n];
+    const std::size_t k = m_nodes[n]->workers.size();
+    const int cpu = order.empty() ? -1 : order[k % order.size()];
+
+    m_workers.push_back(std::unique_ptr<worker>(new worker{
+        .owner = this,
+        .index = i,
+        .node = n,
+        .cpu = cpu,
+        .core = core_of(cores, cpu),
+        .numa_node = system_node_of(spans[n], cpu),
+        .seed = static_cast<std::uint32_t>(2654435761u * (i + 1))}));
+    m_nodes[n]->workers.push_back(m_workers.back().get());
+  }
+
+  // the threads start once every worker is in place to be stolen from
+  for (std::unique_ptr<worker> &w : m_workers) {
+    w->thread = std::thread([this, &w = *w]() { run_worker(w); });
+  }
 }
 
-executor::~executor() { m_thread_pool->join(); }
+executor::~executor() {
+  m_stopping = true;
+  for (std::unique_ptr<node> &n : m_nodes) {
+    std::lock_guard<std::mutex> lock(n->sleep_mutex);
+    n->sleep.notify_all();
+  }
+
+  for (std::unique_ptr<worker> &w : m_workers) {
+    w->thread.join();
+  }
+}
 
 int executor::get_num_threads() const { return m_num_threads; }
 
+int executor::get_num_nodes() const {
+  return static_cast<int>(m_nodes.size());
+}
+
+executor::worker *executor::current_worker() const {
+  return s_current != nullptr && s_current->owner == this ? s_current
+                                                           : nullptr;
+}
+
 void executor::submit(std::function<void(context)> task) {
-  context c = {.task_num = 0};
+  executor::task *t = new executor::task{
+      .function = std::move(task), .task_num = 0, .done = nullptr};
+
+  if (worker *w = current_worker()) {
+    w->deque.push(t);
+  } else {
+    std::lock_guard<std::mutex> lock(m_shared_mutex);
+    m_shared.push_back(t);
+  }
 
-  boost::asio::post(*m_thread_pool, [c, task]() { task(c); });
+  m_stealable.fetch_add(1);
+  wake(-1);
 }
 
 void executor::broadcast(std::function<void(context)> task, bool blocked) {
-  auto latch = std::make_shared<latch_wrapper>(blocked, get_num_threads());
+  // shared by the tasks, which a plain broadcast may outlive
+  auto function =
+      std::make_shared<std::function<void(context)>>(std::move(task));
+  auto done = blocked ? std::make_shared<completion>() : nullptr;
+  if (done) {
+    done->pending = m_num_threads;
+  }
+
+  for (int i = 0; i < m_num_threads; ++i) {
+    node &n = *m_nodes[m_task_nodes[i]];
+    executor::task *t = new executor::task{
+        .function = [function, done](context c) { (*function)(c); },
+        .task_num = i,
+        .done = done.get()};
+    {
+      std::lock_guard<std::mutex> lock(n.pinned_mutex);
+      n.pinned.push_back(t);
+    }
+    n.pinned_count.fetch_add(1);
+    wake(m_task_nodes[i]);
+  }
 
-  for (int i = 0; i < get_num_threads(); ++i) {
-    context c = {.task_num = i};
-    boost::asio::post(*m_thread_pool, [c, latch, task]() {
+  if (done) {
+    wait(*done);
+  }
+}
+
+executor::task *executor::find_task(worker &w) {
+  // the newest task of its own deque first, still warm in cache
+  if (task *t = w.deque.pop()) {
+    m_stealable.fetch_sub(1);
+    return t;
+  }
+
+  node &own = *m_nodes[w.node];
+  if (own.pinned_count.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(own.pinned_mutex);
+    if (!own.pinned.empty()) {
+      task *t = own.pinned.front();
+      own.pinned.pop_front();
+      own.pinned_count.fetch_sub(1);
+      return t;
+    }
+  }
+
+  if (m_stealable.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_shared_mutex);
+    if (!m_shared.empty()) {
+      task *t = m_shared.front();
+      m_shared.pop_front();
+      m_stealable.fetch_sub(1);
+      return t;
+    }
+  }
+
+  // the oldest task of another thread, those of the same node first, each
+  // search starting at a random victim so that thieves spread out
+
+  w.seed ^= w.seed << 13;
+  w.seed ^= w.seed >> 17;
+  w.seed ^= w.seed << 5;
+
+  const int num_nodes = get_num_nodes();
+  for (int k = 0; k < num_nodes; ++k) {
+    const std::vector<worker *> &victims =
+        m_nodes[(w.node + k) % num_nodes]->workers;
+    for (std::size_t j = 0; j < victims.size(); ++j) {
+      worker *victim = victims[(w.seed + j) % victims.size()];
+      if (victim == &w) {
+        continue;
+      }
+      if (task *t = victim->deque.steal()) {
+        m_stealable.fetch_sub(1);
+        return t;
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+void executor::run_task(worker &w, task *t) {
+  t->function({.task_num = t->task_num,
+               .executor_node = w.node,
+               .cpu = w.cpu,
+               .core = w.core,
+               .numa_node = w.numa_node});
+  if (t->done != nullptr) {
+    t->done->finish();
+  }
+  delete t;
+}
+
+bool executor::has_work(const worker &w) const {
+  return m_stealable.load() > 0 || m_nodes[w.node]->pinned_count.load() > 0;
+}
+
+void executor::run_worker(worker &w) {
+  s_current = &w;
+
+  node &own = *m_nodes[w.node];
+  if (w.cpu >= 0) {
+    pin_current_thread({w.cpu});
+  } else if (!own.cpus.empty()) {
+    pin_current_thread(own.cpus);
+  }
+
+  int spins = 0;
+  for (;;) {
+    if (task *t = find_task(w)) {
+      m_running.fetch_add(1);
+      run_task(w, t);
+      m_running.fetch_sub(1);
+      spins = 0;
+
+      // the last task to finish lets the sleeping threads see they are done
+      if (m_stopping && m_running.load() == 0) {
+        for (std::unique_ptr<node> &n : m_nodes) {
+          std::lock_guard<std::mutex> lock(n->sleep_mutex);
+          n->sleep.notify_all();
+        }
+      }
+      continue;
+    }
+
+    if (++spins < idle_spins) {
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+
+    // Sleeps unless work shows up. Announcing the sleep before looking
+    // again pairs with wake, which counts the task before looking for
+    // sleepers, so that one of the two always sees the other.
+
+    std::unique_lock<std::mutex> lock(own.sleep_mutex);
+    own.sleepers.fetch_add(1);
+    while (own.wakeups == 0 && !has_work(w) &&
+           !(m_stopping && m_running.load() == 0)) {
+      own.sleep.wait(lock);
+    }
+    if (own.wakeups > 0) {
+      --own.wakeups;
+    }
+    own.sleepers.fetch_sub(1);
+
+    if (m_stopping && m_running.load() == 0 && !has_work(w)) {
+      return;
+    }
+  }
+}
+
+void executor::wake(int node) {
+  auto wake_one = [](executor::node &n) {
+    if (n.sleepers.load() == 0) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(n.sleep_mutex);
+    ++n.wakeups;
+    n.sleep.notify_one();
+    return true;
+  };
+
+  if (node >= 0) {
+    wake_one(*m_nodes[node]);
+    return;
+  }
+
+  for (std::unique_ptr<executor::node> &n : m_nodes) {
+    if (wake_one(*n)) {
+      return;
+    }
+  }
+}
+
+void executor::wait(completion &c) {
+  if (!help_until([&c]() { return c.pending.load() == 0; })) {
+    std::unique_lock<std::mutex> lock(c.mutex);
+    c.done.wait(lock, [&c]() { return c.pending.load() == 0; });
+    return;
+  }
+
+  // the last task may still hold the lock of the completion
+  std::lock_guard<std::mutex> lock(c.mutex);
+}
+
+bool executor::help_until(const std::function<bool()> &ready) {
+  worker *w = current_worker();
+  if (w == nullptr) {
+    return false;
+  }
+
+  while (!ready()) {
+    if (task *t = find_task(*w)) {
+      run_task(*w, t);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  return true;
+}
+
+task_group::task_group(executor &exec) : m_exec(exec) {}
+
+task_group::~task_group() { m_exec.wait(m_completion); }
+
+void task_group::run(std::function<void(executor::context)> task) {
+  m_completion.pending.fetch_add(1);
+  m_exec.submit([this, task = std::move(task)](executor::context c) {
+    try {
       task(c);
-      latch->count_down();
-    });
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(m_error_mutex);
+      if (!m_error) {
+        m_error = std::current_exception();
+      }
+    }
+    m_completion.finish();
+  });
+}
+
+void task_group::wait() {
+  m_exec.wait(m_completion);
+
+  std::lock_guard<std::mutex> lock(m_error_mutex);
+  if (m_error) {
+    std::exception_ptr error = std::exchange(m_error, nullptr);
+    std::rethrow_exception(error);
+  }
+}
+
+team::team(executor &exec) : m_exec(exec) {}
+
+int team::get_size() const { return m_exec.get_num_threads(); }
+
+void team::run(const std::function<void(executor::context)> &body) {
+  if (m_exec.current_worker() != nullptr) {
+    throw std::logic_error("team: run from a task of its executor");
+  }
+  if (m_exec.m_teamed.exchange(true)) {
+    throw std::logic_error("team: another team is running");
+  }
+
+  m_arrived = 0;
+  m_failed = false;
+  m_error = nullptr;
+
+  m_exec.broadcast(
+      [this, &body](executor::context c) {
+        try {
+          body(c);
+        } catch (const team_aborted &) {
+        } catch (...) {
+          {
+            std::lock_guard<std::mutex> lock(m_error_mutex);
+            if (!m_error) {
+              m_error = std::current_exception();
+            }
+          }
+          // releases the bodies waiting in sync
+          m_failed = true;
+          m_generation.fetch_add(1);
+          m_generation.notify_all();
+        }
+      },
+      true);
+
+  m_exec.m_teamed = false;
+
+  if (m_error) {
+    std::rethrow_exception(std::exchange(m_error, nullptr));
   }
+}
 
-  latch->wait();
+void team::sync() {
+  // cannot move on before this thread arrives
+  const std::uint32_t generation = m_generation.load();
+  if (m_failed) {
+    throw team_aborted();
+  }
+
+  if (m_arrived.fetch_add(1) + 1 == get_size()) {
+    m_arrived = 0;
+    m_generation.fetch_add(1);
+    m_generation.notify_all();
+    return;
+  }
+
+  for (int i = 0; i < barrier_spins && m_generation.load() == generation;
+       ++i) {
+    if (i >= barrier_busy_spins) {
+      std::this_thread::yield();
+    }
+  }
+  while (m_generation.load() == generation) {
+    m_generation.wait(generation);
+  }
+
+  if (m_failed) {
+    throw team_aborted();
+  }
 }
 
 } // namespace praster
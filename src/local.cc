@@ -0,0 +1,322 @@
+#include "local.h"
+#include "local_kernels.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace praster::local {
+
+namespace {
+
+isa detect_isa() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+#if defined(PRASTER_HAVE_AVX512)
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512vl")) {
+    return isa::avx512;
+  }
+#endif
+#if defined(PRASTER_HAVE_AVX2)
+  if (__builtin_cpu_supports("avx2")) {
+    return isa::avx2;
+  }
+#endif
+#endif
+  return isa::scalar;
+}
+
+// The PRASTER_ISA environment variable may lower the instruction set picked
+// at startup, which is mostly useful to compare the kernels.
+isa initial_isa() noexcept {
+  const isa supported = supported_isa();
+  const char *requested = std::getenv("PRASTER_ISA");
+  if (requested == nullptr) {
+    return supported;
+  }
+
+  const std::string name(requested);
+  for (isa candidate : {isa::scalar, isa::avx2, isa::avx512}) {
+    if (name == isa_name(candidate) && candidate <= supported) {
+      return candidate;
+    }
+  }
+  return supported;
+}
+
+std::atomic<isa> &current_isa() noexcept {
+  static std::atomic<isa> current(initial_isa());
+  return current;
+}
+
+template <typename T> const kernel_table<T> &kernels() noexcept {
+  switch (active_isa()) {
+#if defined(PRASTER_HAVE_AVX512)
+  case isa::avx512:
+    return avx512::kernels<T>();
+#endif
+#if defined(PRASTER_HAVE_AVX2)
+  case isa::avx2:
+    return avx2::kernels<T>();
+#endif
+  default:
+    return scalar::kernels<T>();
+  }
+}
+
+// Tells whether a compact tile is left as it is by an operation, tried on a
+// single cell holding the value of the tile. Every operation preserves
+// nodata, so empty tiles always are.
+template <pixel_type T, typename F>
+bool unchanged(const basic_tile<T> &tile, F &&op) {
+  switch (tile.get_state()) {
+  case tile_state::empty:
+    return true;
+  case tile_state::uniform: {
+    T value = tile.get_value(0, 0);
+    op(&value);
+    return value == tile.get_value(0, 0);
+  }
+  default:
+    return false;
+  }
+}
+
+// Tile to tile operations turn every cell to nodata where the other tile is
+// nodata. Only the interior is written, as on every other path; the tile
+// is compacted if its margins hold nodata as well.
+template <pixel_type T>
+bool cleared(basic_tile<T> &tile, const basic_tile<T> &other) {
+  if (other.get_state() != tile_state::empty) {
+    return false;
+  }
+  const T nodata = tile.get_nodata();
+  tile.transform([nodata](T) { return nodata; });
+  tile.compact();
+  return true;
+}
+
+template <pixel_type T>
+void apply(basic_tile<T> &tile, arithmetic op, T value) {
+  const kernel_table<T> &table = kernels<T>();
+  if (unchanged(tile, [&](T *cell) {
+        table.arithmetic_scalar(op, cell, 1, value, tile.get_nodata());
+      })) {
+    return;
+  }
+
+  for (int y = 0; y < tile.get_height(); ++y) {
+    std::span<T> row = tile.get_row(y);
+    table.arithmetic_scalar(op, row.data(), row.size(), value,
+                            tile.get_nodata());
+  }
+}
+
+template <pixel_type T>
+void apply(basic_tile<T> &tile, arithmetic op, const basic_tile<T> &other) {
+  if (tile.get_width() != other.get_width() ||
+      tile.get_height() != other.get_height()) {
+    throw std::invalid_argument("local: tile sizes differ");
+  }
+
+  const kernel_table<T> &table = kernels<T>();
+  if (tile.get_state() == tile_state::empty || cleared(tile, other)) {
+    return;
+  }
+
+  if (other.is_compact() && unchanged(tile, [&](T *cell) {
+        const T other_value = other.get_value(0, 0);
+        table.arithmetic_row(op, cell, &other_value, 1, tile.get_nodata(),
+                             other.get_nodata());
+      })) {
+    return;
+  }
+
+  for (int y = 0; y < tile.get_height(); ++y) {
+    std::span<T> row = tile.get_row(y);
+    table.arithmetic_row(op, row.data(), other.get_row(y).data(), row.size(),
+                         tile.get_nodata(), other.get_nodata());
+  }
+}
+
+} // namespace
+
+template <typename T> const kernel_table<T> &active_kernels() noexcept {
+  return kernels<T>();
+}
+
+isa supported_isa() noexcept {
+  static const isa supported = detect_isa();
+  return supported;
+}
+
+isa active_isa() noexcept {
+  return current_isa().load(std::memory_order_relaxed);
+}
+
+void set_isa(isa target) {
+  if (target > supported_isa()) {
+    throw std::invalid_argument("local: instruction set not supported");
+  }
+  current_isa().store(target, std::memory_order_relaxed);
+}
+
+const char *isa_name(isa target) noexcept {
+  switch (target) {
+  case isa::avx2:
+    return "avx2";
+  case isa::avx512:
+    return "avx512";
+  default:
+    return "scalar";
+  }
+}
+
+template <pixel_type T> void add(basic_tile<T> &tile, T value) {
+  apply(tile, arithmetic::add, value);
+}
+
+template <pixel_type T> void subtract(basic_tile<T> &tile, T value) {
+  apply(tile, arithmetic::subtract, value);
+}
+
+template <pixel_type T> void multiply(basic_tile<T> &tile, T value) {
+  apply(tile, arithmetic::multiply, value);
+}
+
+template <pixel_type T> void divide(basic_tile<T> &tile, T value) {
+  apply(tile, arithmetic::divide, value);
+}
+
+template <pixel_type T>
+void add(basic_tile<T> &tile, const basic_tile<T> &other) {
+  apply(tile, arithmetic::add, other);
+}
+
+template <pixel_type T>
+void subtract(basic_tile<T> &tile, const basic_tile<T> &other) {
+  apply(tile, arithmetic::subtract, other);
+}
+
+template <pixel_type T>
+void multiply(basic_tile<T> &tile, const basic_tile<T> &other) {
+  apply(tile, arithmetic::multiply, other);
+}
+
+template <pixel_type T>
+void divide(basic_tile<T> &tile, const basic_tile<T> &other) {
+  apply(tile, arithmetic::divide, other);
+}
+
+template <pixel_type T> void clamp(basic_tile<T> &tile, T low, T high) {
+  const kernel_table<T> &table = kernels<T>();
+  if (unchanged(tile, [&](T *cell) {
+        table.clamp(cell, 1, low, high, tile.get_nodata());
+      })) {
+    return;
+  }
+
+  for (int y = 0; y < tile.get_height(); ++y) {
+    std::span<T> row = tile.get_row(y);
+    table.clamp(row.data(), row.size(), low, high, tile.get_nodata());
+  }
+}
+
+template <pixel_type T>
+void threshold(basic_tile<T> &tile, T threshold, T below, T above) {
+  const kernel_table<T> &table = kernels<T>();
+  if (unchanged(tile, [&](T *cell) {
+        table.threshold(cell, 1, threshold, below, above, tile.get_nodata());
+      })) {
+    return;
+  }
+
+  for (int y = 0; y < tile.get_height(); ++y) {
+    std::span<T> row = tile.get_row(y);
+    table.threshold(row.data(), row.size(), threshold, below, above,
+                    tile.get_nodata());
+  }
+}
+
+template <pixel_type T>
+void reclassify(basic_tile<T> &tile,
+                const std::vector<reclass_rule<T>> &rules) {
+  std::vector<T> low, high, value;
+  low.reserve(rules.size());
+  high.reserve(rules.size());
+  value.reserve(rules.size());
+  for (const reclass_rule<T> &rule : rules) {
+    low.push_back(rule.low);
+    high.push_back(rule.high);
+    value.push_back(rule.value);
+  }
+
+  const kernel_table<T> &table = kernels<T>();
+  if (unchanged(tile, [&](T *cell) {
+        table.reclassify(cell, 1, low.data(), high.data(), value.data(),
+                         rules.size(), tile.get_nodata());
+      })) {
+    return;
+  }
+
+  for (int y = 0; y < tile.get_height(); ++y) {
+    std::span<T> row = tile.get_row(y);
+    table.reclassify(row.data(), row.size(), low.data(), high.data(),
+                     value.data(), rules.size(), tile.get_nodata());
+  }
+}
+
+template <pixel_type T>
+void mask(basic_tile<T> &tile, const basic_tile<T> &mask) {
+  if (tile.get_width() != mask.get_width() ||
+      tile.get_height() != mask.get_height()) {
+    throw std::invalid_argument("local: tile sizes differ");
+  }
+
+  const kernel_table<T> &table = kernels<T>();
+  if (tile.get_state() == tile_state::empty || cleared(tile, mask)) {
+    return;
+  }
+
+  if (mask.is_compact()) {
+    return;
+  }
+
+  for (int y = 0; y < tile.get_height(); ++y) {
+    std::span<T> row = tile.get_row(y);
+    table.mask(row.data(), mask.get_row(y).data(), row.size(),
+               tile.get_nodata(), mask.get_nodata());
+  }
+}
+
+#define PRASTER_INSTANTIATE_LOCAL(T)                                           \
+  template void add(basic_tile<T> &, T);                                       \
+  template void subtract(basic_tile<T> &, T);                                  \
+  template void multiply(basic_tile<T> &, T);                                  \
+  template void divide(basic_tile<T> &, T);                                    \
+  template void add(basic_tile<T> &, const basic_tile<T> &);                   \
+  template void subtract(basic_tile<T> &, const basic_tile<T> &);              \
+  template void multiply(basic_tile<T> &, const basic_tile<T> &);              \
+  template void divide(basic_tile<T> &, const basic_tile<T> &);                \
+  template void clamp(basic_tile<T> &, T, T);                                  \
+  template void threshold(basic_tile<T> &, T, T, T);                           \
+  template void reclassify(basic_tile<T> &,                                    \
+                           const std::vector<reclass_rule<T>> &);              \
+  template void mask(basic_tile<T> &, const basic_tile<T> &);                  \
+  template const kernel_table<T> &active_kernels<T>() noexcept;
+
+PRASTER_INSTANTIATE_LOCAL(std::uint8_t)
+PRASTER_INSTANTIATE_LOCAL(std::int16_t)
+PRASTER_INSTANTIATE_LOCAL(std::uint16_t)
+PRASTER_INSTANTIATE_LOCAL(std::int32_t)
+PRASTER_INSTANTIATE_LOCAL(std::uint32_t)
+PRASTER_INSTANTIATE_LOCAL(float)
+PRASTER_INSTANTIATE_LOCAL(double)
+
+#undef PRASTER_INSTANTIATE_LOCAL
+
+} // namespace praster::local
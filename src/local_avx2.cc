@@ -0,0 +1,2 @@
+#define PRASTER_LOCAL_ISA avx2
+#include "local_isa.h"
@@ -0,0 +1,2 @@
+#define PRASTER_LOCAL_ISA avx512
+#include "local_isa.h"
@@ -0,0 +1,271 @@
+// Row kernels of the local operations. This file is included once per
+// instruction set by local_scalar.cc, local_avx2.cc and local_avx512.cc, which
+// are compiled with the matching target flags and define PRASTER_LOCAL_ISA to
+// the namespace the kernels are placed in. The loops are written so that the
+// compiler vectorizes them for the target; they must not call inline library
+// functions, whose out-of-line copies could be shared with code compiled for
+// another instruction set.
+
+#include "local_kernels.h"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace praster::local::PRASTER_LOCAL_ISA {
+
+namespace {
+
+constexpr std::size_t chunk_size = 256;
+
+// The type sums, differences and products of T are computed in. They are
+// computed for nodata cells too, so integers are taken unsigned, where they
+// wrap around rather than overflow, which would be undefined.
+template <typename T> struct wrapping {
+  using type = T;
+};
+
+template <std::integral T> struct wrapping<T> {
+  using type = std::make_unsigned_t<decltype(T{} + T{})>;
+};
+
+template <typename T> using wrapping_t = typename wrapping<T>::type;
+
+// Whether a / b traps: for a zero divisor, or for the one quotient of signed
+// integers that does not fit, the lowest value divided by -1.
+template <typename T> inline bool traps(T a, T b) {
+  if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    constexpr T lowest = std::numeric_limits<T>::min();
+    return (b == 0) | ((a == lowest) & (b == T(-1)));
+  } else {
+    return b == 0;
+  }
+}
+
+template <typename T>
+void arithmetic_scalar(arithmetic op, T *__restrict row, std::size_t n,
+                       T value, T nodata) {
+  using W = wrapping_t<T>;
+
+  switch (op) {
+  case arithmetic::add:
+    for (std::size_t i = 0; i < n; ++i) {
+      const T v = row[i];
+      const T result = static_cast<T>(static_cast<W>(v) +
+                                      static_cast<W>(value));
+      row[i] = v == nodata ? nodata : result;
+    }
+    break;
+  case arithmetic::subtract:
+    for (std::size_t i = 0; i < n; ++i) {
+      const T v = row[i];
+      const T result = static_cast<T>(static_cast<W>(v) -
+                                      static_cast<W>(value));
+      row[i] = v == nodata ? nodata : result;
+    }
+    break;
+  case arithmetic::multiply:
+    for (std::size_t i = 0; i < n; ++i) {
+      const T v = row[i];
+      const T result = static_cast<T>(static_cast<W>(v) *
+                                      static_cast<W>(value));
+      row[i] = v == nodata ? nodata : result;
+    }
+    break;
+  case arithmetic::divide:
+    if (value == 0) {
+      for (std::size_t i = 0; i < n; ++i) {
+        row[i] = nodata;
+      }
+      break;
+    }
+    // the lowest value divided by -1 would trap, nodata cells included, so
+    // it is divided by one instead, which wraps as the negation would
+    for (std::size_t i = 0; i < n; ++i) {
+      const T v = row[i];
+      const T result = static_cast<T>(v / (traps(v, value) ? T(1) : value));
+      row[i] = v == nodata ? nodata : result;
+    }
+    break;
+  }
+}
+
+template <typename T>
+void arithmetic_row(arithmetic op, T *__restrict row,
+                    const T *__restrict other, std::size_t n, T nodata,
+                    T other_nodata) {
+  using W = wrapping_t<T>;
+
+  switch (op) {
+  case arithmetic::add:
+    for (std::size_t i = 0; i < n; ++i) {
+      const T a = row[i];
+      const T b = other[i];
+      const T result = static_cast<T>(static_cast<W>(a) +
+                                      static_cast<W>(b));
+      row[i] = (a == nodata) | (b == other_nodata) ? nodata : result;
+    }
+    break;
+  case arithmetic::subtract:
+    for (std::size_t i = 0; i < n; ++i) {
+      const T a = row[i];
+      const T b = other[i];
+      const T result = static_cast<T>(static_cast<W>(a) -
+                                      static_cast<W>(b));
+      row[i] = (a == nodata) | (b == other_nodata) ? nodata : result;
+    }
+    break;
+  case arithmetic::multiply:
+    for (std::size_t i = 0; i < n; ++i) {
+      const T a = row[i];
+      const T b = other[i];
+      const T result = static_cast<T>(static_cast<W>(a) *
+                                      static_cast<W>(b));
+      row[i] = (a == nodata) | (b == other_nodata) ? nodata : result;
+    }
+    break;
+  case arithmetic::divide:
+    // the divisor is replaced by one where the quotient would trap so that
+    // it can be computed unconditionally; a zero divisor makes the cell
+    // nodata, the lowest value divided by -1 wraps as the negation would
+    for (std::size_t i = 0; i < n; ++i) {
+      const T a = row[i];
+      const T b = other[i];
+      const T result = static_cast<T>(a / (traps(a, b) ? T(1) : b));
+      row[i] =
+          (a == nodata) | (b == other_nodata) | (b == 0) ? nodata : result;
+    }
+    break;
+  }
+}
+
+template <typename T>
+void clamp(T *__restrict row, std::size_t n, T low, T high, T nodata) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const T v = row[i];
+    const T clamped = v < low ? low : (v > high ? high : v);
+    row[i] = v == nodata ? nodata : clamped;
+  }
+}
+
+template <typename T>
+void threshold(T *__restrict row, std::size_t n, T threshold, T below,
+               T above, T nodata) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const T v = row[i];
+    const T classified = v < threshold ? below : above;
+    row[i] = v == nodata ? nodata : classified;
+  }
+}
+
+template <typename T>
+void reclassify(T *__restrict row, std::size_t n, const T *low, const T *high,
+                const T *value, std::size_t rules, T nodata) {
+  T source[chunk_size];
+
+  for (std::size_t start = 0; start < n; start += chunk_size) {
+    const std::size_t length =
+        n - start < chunk_size ? n - start : chunk_size;
+    T *__restrict target = row + start;
+
+    for (std::size_t i = 0; i < length; ++i) {
+      source[i] = target[i];
+    }
+
+    // rules are applied last to first against the original values so that
+    // the first matching rule wins
+    for (std::size_t r = rules; r-- > 0;) {
+      const T rule_low = low[r];
+      const T rule_high = high[r];
+      const T rule_value = value[r];
+      for (std::size_t i = 0; i < length; ++i) {
+        const T v = source[i];
+        const bool match = (v != nodata) & (v >= rule_low) & (v < rule_high);
+        target[i] = match ? rule_value : target[i];
+      }
+    }
+  }
+}
+
+template <typename T>
+void mask(T *__restrict row, const T *__restrict mask, std::size_t n,
+          T nodata, T mask_nodata) {
+  for (std::size_t i = 0; i < n; ++i) {
+    row[i] = mask[i] == mask_nodata ? nodata : row[i];
+  }
+}
+
+// The row is split into lanes, each keeping its own count, bounds and sum,
+// so that the lanes map onto vector registers; they are combined at the end.
+template <typename T>
+void statistics(const T *__restrict row, std::size_t n, T nodata,
+                tile_statistics<T> &stats) {
+  constexpr std::size_t lanes = 8;
+
+  std::size_t count[lanes];
+  T low[lanes];
+  T high[lanes];
+  double sum[lanes];
+  for (std::size_t l = 0; l < lanes; ++l) {
+    count[l] = 0;
+    low[l] = stats.min;
+    high[l] = stats.max;
+    sum[l] = 0;
+  }
+
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    for (std::size_t l = 0; l < lanes; ++l) {
+      const T v = row[i + l];
+      const bool valid = v != nodata;
+      count[l] += valid;
+      low[l] = valid & (v < low[l]) ? v : low[l];
+      high[l] = valid & (v > high[l]) ? v : high[l];
+      sum[l] += valid ? static_cast<double>(v) : 0.0;
+    }
+  }
+
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+    const T v = row[i];
+    const bool valid = v != nodata;
+    count[l] += valid;
+    low[l] = valid & (v < low[l]) ? v : low[l];
+    high[l] = valid & (v > high[l]) ? v : high[l];
+    sum[l] += valid ? static_cast<double>(v) : 0.0;
+  }
+
+  std::size_t valid = 0;
+  for (std::size_t l = 0; l < lanes; ++l) {
+    valid += count[l];
+    stats.min = low[l] < stats.min ? low[l] : stats.min;
+    stats.max = high[l] > stats.max ? high[l] : stats.max;
+    stats.sum += sum[l];
+  }
+
+  stats.count += valid;
+  stats.nodata_count += n - valid;
+}
+
+} // namespace
+
+template <typename T> const kernel_table<T> &kernels() noexcept {
+  static constexpr kernel_table<T> table = {
+      arithmetic_scalar<T>, arithmetic_row<T>, clamp<T>,
+      threshold<T>,         reclassify<T>,     mask<T>,
+      statistics<T>};
+  return table;
+}
+
+template const kernel_table<std::uint8_t> &kernels<std::uint8_t>() noexcept;
+template const kernel_table<std::int16_t> &kernels<std::int16_t>() noexcept;
+template const kernel_table<std::uint16_t> &
+kernels<std::uint16_t>() noexcept;
+template const kernel_table<std::int32_t> &kernels<std::int32_t>() noexcept;
+template const kernel_table<std::uint32_t> &
+kernels<std::uint32_t>() noexcept;
+template const kernel_table<float> &kernels<float>() noexcept;
+template const kernel_table<double> &kernels<double>() noexcept;
+
+} // namespace praster::local::PRASTER_LOCAL_ISA
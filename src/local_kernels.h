@@ -0,0 +1,51 @@
+#ifndef PRASTER_LOCAL_KERNELS_H
+#define PRASTER_LOCAL_KERNELS_H
+
+#include "statistics.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace praster::local {
+
+enum class arithmetic { add, subtract, multiply, divide };
+
+// Row kernels of the local operations. One table is compiled per instruction
+// set, see local_isa.h, and local.cc dispatches to one of them at runtime.
+
+template <typename T> struct kernel_table {
+  void (*arithmetic_scalar)(arithmetic op, T *row, std::size_t n, T value,
+                            T nodata);
+  void (*arithmetic_row)(arithmetic op, T *row, const T *other,
+                         std::size_t n, T nodata, T other_nodata);
+  void (*clamp)(T *row, std::size_t n, T low, T high, T nodata);
+  void (*threshold)(T *row, std::size_t n, T threshold, T below, T above,
+                    T nodata);
+  void (*reclassify)(T *row, std::size_t n, const T *low, const T *high,
+                     const T *value, std::size_t rules, T nodata);
+  void (*mask)(T *row, const T *mask, std::size_t n, T nodata,
+               T mask_nodata);
+  // Adds the cells of the row to the statistics.
+  void (*statistics)(const T *row, std::size_t n, T nodata,
+                     tile_statistics<T> &stats);
+};
+
+// Returns the table of the instruction set the operations currently
+// dispatch to, see local::active_isa.
+template <typename T> const kernel_table<T> &active_kernels() noexcept;
+
+namespace scalar {
+template <typename T> const kernel_table<T> &kernels() noexcept;
+}
+
+namespace avx2 {
+template <typename T> const kernel_table<T> &kernels() noexcept;
+}
+
+namespace avx512 {
+template <typename T> const kernel_table<T> &kernels() noexcept;
+}
+
+} // namespace praster::local
+
+#endif
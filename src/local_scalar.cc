@@ -0,0 +1,2 @@
+#define PRASTER_LOCAL_ISA scalar
+#include "local_isa.h"
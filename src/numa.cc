@@ -0,0 +1,197 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace praster {
+
+namespace {
+
+std::string read_line(const std::filesystem::path &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+// Returns the number of a sysfs entry such as "node1", or -1 if the name
+// is not one.
+int node_number(const std::string &name) {
+  if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+      !std::all_of(name.begin() + 4, name.end(),
+                   [](char c) { return c >= '0' && c <= '9'; })) {
+    return -1;
+  }
+  return std::stoi(name.substr(4));
+}
+
+} // namespace
+
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+
+  std::istringstream in(list);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    try {
+      std::size_t end = 0;
+      const int first = std::stoi(range, &end);
+      const int last =
+          end < range.size() && range[end] == '-'
+              ? std::stoi(range.substr(end + 1))
+              : first;
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      continue;
+    }
+  }
+
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+std::vector<numa_node> read_numa_topology(const std::string &node_path) {
+  std::vector<numa_node> nodes;
+
+  std::error_code error;
+  std::filesystem::directory_iterator it(node_path, error);
+  if (!error) {
+    for (const std::filesystem::directory_entry &entry : it) {
+      const int id = node_number(entry.path().filename().string());
+      if (id < 0) {
+        continue;
+      }
+
+      // nodes of memory alone have no processor to run threads on
+      std::vector<int> cpus =
+          parse_cpu_list(read_line(entry.path() / "cpulist"));
+      if (!cpus.empty()) {
+        nodes.push_back({.id = id, .cpus = std::move(cpus)});
+      }
+    }
+  }
+
+  if (nodes.empty()) {
+    return {{.id = 0, .cpus = allowed_cpus()}};
+  }
+
+  std::sort(nodes.begin(), nodes.end(),
+            [](const numa_node &a, const numa_node &b) { return a.id < b.id; });
+  return nodes;
+}
+
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+
+  if (cpus.empty()) {
+    const int count = std::max(1u, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < count; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<std::vector<int>>
+read_cpu_cores(const std::vector<int> &cpus, const std::string &cpu_path) {
+  std::map<int, std::vector<int>> cores;
+  for (int cpu : cpus) {
+    const std::vector<int> siblings = parse_cpu_list(
+        read_line(std::filesystem::path(cpu_path) /
+                  ("cpu" + std::to_string(cpu)) / "topology" /
+                  "thread_siblings_list"));
+    cores[siblings.empty() ? cpu : siblings.front()].push_back(cpu);
+  }
+
+  std::vector<std::vector<int>> groups;
+  for (auto &[first, group] : cores) {
+    std::sort(group.begin(), group.end());
+    groups.push_back(std::move(group));
+  }
+  std::sort(groups.begin(), groups.end());
+  return groups;
+}
+
+std::vector<int>
+compact_order(const std::vector<std::vector<std::vector<int>>> &nodes) {
+  std::vector<int> order;
+  for (const std::vector<std::vector<int>> &cores : nodes) {
+    for (const std::vector<int> &core : cores) {
+      order.insert(order.end(), core.begin(), core.end());
+    }
+  }
+  return order;
+}
+
+std::vector<int>
+scatter_order(const std::vector<std::vector<std::vector<int>>> &nodes) {
+  // every node's processors one per core first, then the nodes interleaved
+  std::vector<std::vector<int>> spread;
+  for (const std::vector<std::vector<int>> &cores : nodes) {
+    std::vector<int> cpus;
+    for (std::size_t round = 0;; ++round) {
+      const std::size_t before = cpus.size();
+      for (const std::vector<int> &core : cores) {
+        if (round < core.size()) {
+          cpus.push_back(core[round]);
+        }
+      }
+      if (cpus.size() == before) {
+        break;
+      }
+    }
+    spread.push_back(std::move(cpus));
+  }
+
+  std::vector<int> order;
+  for (std::size_t i = 0;; ++i) {
+    const std::size_t before = order.size();
+    for (const std::vector<int> &cpus : spread) {
+      if (i < cpus.size()) {
+        order.push_back(cpus[i]);
+      }
+    }
+    if (order.size() == before) {
+      break;
+    }
+  }
+  return order;
+}
+
+bool pin_current_thread(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  bool any = false;
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+      any = true;
+    }
+  }
+
+  return any &&
+         pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+} // namespace praster
@@ -0,0 +1,180 @@
+#include "pipeline.h"
+#include "executor.h"
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace praster {
+
+namespace {
+
+// Runs the work on the executor, or right away without one. The future
+// holds the exception of the work if it throws.
+std::future<void> start(executor *io, std::function<void()> work) {
+  auto done = std::make_shared<std::promise<void>>();
+  std::future<void> result = done->get_future();
+
+  auto task = [done, work = std::move(work)](executor::context) {
+    try {
+      work();
+      done->set_value();
+    } catch (...) {
+      done->set_exception(std::current_exception());
+    }
+  };
+
+  if (io != nullptr) {
+    io->submit(task);
+  } else {
+    task({.task_num = 0});
+  }
+  return result;
+}
+
+} // namespace
+
+template <pixel_type T>
+basic_pipeline<T>::basic_pipeline(int ds_width, int ds_height, T nodata,
+                                  int tile_width, int tile_height,
+                                  std::vector<stripe_extent> stripes,
+                                  read_callback reader, write_callback writer,
+                                  const stripe_options &options)
+    : m_ds_width(ds_width), m_ds_height(ds_height), m_nodata(nodata),
+      m_tile_width(tile_width), m_tile_height(tile_height),
+      m_stripes(std::move(stripes)), m_reader(std::move(reader)),
+      m_writer(std::move(writer)), m_options(options) {
+
+  if (m_stripes.empty()) {
+    throw std::invalid_argument("pipeline: no stripes");
+  }
+
+  int y = 0;
+  for (const stripe_extent &extent : m_stripes) {
+    if (extent.y != y || extent.height <= 0) {
+      throw std::invalid_argument("pipeline: stripes not contiguous");
+    }
+    y += extent.height;
+  }
+
+  if (y != m_ds_height) {
+    throw std::invalid_argument("pipeline: stripes do not cover the dataset");
+  }
+}
+
+template <pixel_type T>
+typename basic_pipeline<T>::stripe_type
+basic_pipeline<T>::load(std::size_t index,
+                        const stage_callback &prepare) const {
+  stripe_type s = stripe_type::build(
+      static_cast<int>(index), m_stripes[index].y, m_stripes[index].height,
+      m_ds_width, m_ds_height, m_nodata, m_tile_width, m_tile_height,
+      m_reader, m_options);
+
+  if (prepare) {
+    prepare(s);
+  }
+  return s;
+}
+
+template <pixel_type T>
+pipeline_stats basic_pipeline<T>::run(const stage_callback &prepare,
+                                      const stage_callback &compute) {
+  return run(prepare, compute, nullptr);
+}
+
+template <pixel_type T>
+pipeline_stats basic_pipeline<T>::run(const stage_callback &prepare,
+                                      const stage_callback &compute,
+                                      executor &io) {
+  return run(prepare, compute, &io);
+}
+
+template <pixel_type T>
+pipeline_stats basic_pipeline<T>::run(const stage_callback &prepare,
+                                      const stage_callback &compute,
+                                      executor *io) {
+  const std::size_t count = m_stripes.size();
+
+  std::vector<std::optional<stripe_type>> resident(count);
+  std::vector<std::future<void>> loaded(count);
+  std::future<void> written;
+
+  pipeline_stats stats = {.stripes = count};
+  std::size_t started = 0;
+  std::size_t released = 0;
+
+  // Stripes are loaded far enough ahead that the next one is ready, its
+  // halo exchangeable, when a stripe is computed. With an executor the one
+  // after is loaded meanwhile.
+
+  const std::size_t ahead = io != nullptr ? 2 : 1;
+
+  auto release = [&]() {
+    written.get();
+    resident[released].reset();
+    ++released;
+  };
+
+  try {
+    for (std::size_t k = 0; k < count; ++k) {
+      for (; started < std::min(k + ahead + 1, count); ++started) {
+        loaded[started] = start(io, [this, &resident, &prepare, started]() {
+          resident[started].emplace(load(started, prepare));
+        });
+        stats.peak_resident_stripes =
+            std::max(stats.peak_resident_stripes, started + 1 - released);
+      }
+
+      if (k == 0) {
+        loaded[k].get();
+      }
+
+      if (k + 1 < count) {
+        loaded[k + 1].get();
+        stats.exchanges.merge(
+            resident[k]->update_borders(nullptr, &*resident[k + 1]));
+        stats.exchanges.merge(
+            resident[k + 1]->update_borders(&*resident[k], nullptr));
+      }
+
+      compute(*resident[k]);
+
+      if (written.valid()) {
+        release();
+      }
+
+      written = start(io, [this, &resident, k]() {
+        resident[k]->write(m_writer);
+      });
+    }
+
+    release();
+  } catch (...) {
+    // the pending loads and writes still use the stripes
+    for (std::future<void> &f : loaded) {
+      if (f.valid()) {
+        f.wait();
+      }
+    }
+    if (written.valid()) {
+      written.wait();
+    }
+    throw;
+  }
+
+  return stats;
+}
+
+template class basic_pipeline<std::uint8_t>;
+template class basic_pipeline<std::int16_t>;
+template class basic_pipeline<std::uint16_t>;
+template class basic_pipeline<std::int32_t>;
+template class basic_pipeline<std::uint32_t>;
+template class basic_pipeline<float>;
+template class basic_pipeline<double>;
+
+} // namespace praster
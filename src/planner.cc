@@ -0,0 +1,277 @@
+#include "planner.h"
+#include "executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace praster {
+
+namespace {
+
+// tiles per thread for the work to balance when tiles take uneven time
+constexpr int tiles_per_thread = 4;
+
+// below this, the margins and the per-tile overhead outweigh the interior
+constexpr int min_tile_side = 16;
+
+// Parses sysfs cache sizes such as "48K", "2048K" or "32M"; zero if it
+// cannot.
+std::size_t parse_size(const std::string &text) {
+  std::size_t end = 0;
+  std::size_t value = 0;
+  try {
+    value = std::stoull(text, &end);
+  } catch (const std::exception &) {
+    return 0;
+  }
+
+  const char unit = end < text.size() ? text[end] : ' ';
+  if (unit == 'K') {
+    return value * 1024;
+  }
+  if (unit == 'M') {
+    return value * 1024 * 1024;
+  }
+  if (unit == 'G') {
+    return value * 1024 * 1024 * 1024;
+  }
+  return value;
+}
+
+std::string read_line(const std::filesystem::path &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+std::string format_bytes(std::size_t bytes) {
+  std::ostringstream out;
+  if (bytes >= 1024 * 1024) {
+    out << std::fixed << std::setprecision(bytes % (1024 * 1024) ? 1 : 0)
+        << bytes / (1024.0 * 1024.0) << " MiB";
+  } else if (bytes >= 1024) {
+    out << bytes / 1024 << " KiB";
+  } else {
+    out << bytes << " bytes";
+  }
+  return out.str();
+}
+
+int count(int extent, int size) { return (extent + size - 1) / size; }
+
+// Returns the bytes of the front and back buffers of a tile, rows padded to
+// whole cache lines as basic_tile does.
+std::size_t buffer_bytes(int width, int height, int halo,
+                         std::size_t cell_bytes, std::size_t line_bytes) {
+  const std::size_t row_bytes =
+      (static_cast<std::size_t>(width + 2 * halo) * cell_bytes + line_bytes -
+       1) /
+      line_bytes * line_bytes;
+  return 2 * row_bytes * static_cast<std::size_t>(height + 2 * halo);
+}
+
+// Shrinks the size until the last of the tiles splitting the extent covers
+// the halo of its neighbour, as basic_stripe::build requires.
+int fit(int extent, int size, int halo) {
+  size = std::min(size, extent);
+  while (size > halo && extent % size != 0 && extent % size < halo) {
+    --size;
+  }
+  if (size < std::max(halo, 1)) {
+    throw std::invalid_argument("planner: dataset too small for the halo");
+  }
+  return size;
+}
+
+} // namespace
+
+cache_topology read_cache_topology(const std::string &cache_path) {
+  cache_topology caches;
+
+  std::error_code error;
+  std::filesystem::directory_iterator it(cache_path, error);
+  if (error) {
+    return caches;
+  }
+
+  for (const std::filesystem::directory_entry &entry : it) {
+    if (entry.path().filename().string().rfind("index", 0) != 0) {
+      continue;
+    }
+
+    const std::string type = read_line(entry.path() / "type");
+    if (type != "Data" && type != "Unified") {
+      continue;
+    }
+
+    const std::size_t size = parse_size(read_line(entry.path() / "size"));
+    const std::size_t line =
+        parse_size(read_line(entry.path() / "coherency_line_size"));
+    const std::string level = read_line(entry.path() / "level");
+    if (size == 0) {
+      continue;
+    }
+
+    if (level == "1") {
+      caches.l1_bytes = size;
+    } else if (level == "2") {
+      caches.l2_bytes = size;
+    } else if (level == "3") {
+      caches.l3_bytes = size;
+    } else {
+      continue;
+    }
+
+    if (line != 0) {
+      caches.line_bytes = line;
+    }
+    caches.detected = true;
+  }
+
+  return caches;
+}
+
+partition_plan plan_partition(int ds_width, int ds_height,
+                              std::size_t cell_bytes, int halo,
+                              int num_threads, const cache_topology &caches) {
+  if (ds_width <= 0 || ds_height <= 0) {
+    throw std::invalid_argument("planner: empty dataset");
+  }
+
+  if (cell_bytes == 0 || halo < 0 || num_threads <= 0) {
+    throw std::invalid_argument("planner: invalid cell size, halo or threads");
+  }
+
+  const std::size_t line_bytes = std::max<std::size_t>(caches.line_bytes, 1);
+  const int line_cells =
+      static_cast<int>(std::max<std::size_t>(line_bytes / cell_bytes, 1));
+  const int min_side = std::max(min_tile_side, halo);
+
+  std::ostringstream explanation;
+  explanation << "caches: L2 " << format_bytes(caches.l2_bytes) << ", L3 "
+              << format_bytes(caches.l3_bytes) << ", " << line_bytes
+              << "-byte lines"
+              << (caches.detected ? ", read from sysfs"
+                                  : ", assumed as sysfs tells nothing")
+              << '\n';
+
+  // The largest square tile whose buffers fit in half of L2, the other half
+  // left to the kernels and whatever else the thread touches, with rows a
+  // whole number of cache lines.
+
+  const std::size_t budget = caches.l2_bytes / 2;
+  const int side = static_cast<int>(
+      std::sqrt(static_cast<double>(budget) / (2 * cell_bytes)));
+
+  int width = std::max((side - 2 * halo) / line_cells * line_cells, line_cells);
+  width = std::min(width, ds_width);
+
+  int height = std::max(min_side, side - 2 * halo);
+  while (height > min_side &&
+         buffer_bytes(width, height, halo, cell_bytes, line_bytes) > budget) {
+    --height;
+  }
+
+  // a dataset narrower than the tile makes room for taller tiles
+  while (buffer_bytes(width, height + 1, halo, cell_bytes, line_bytes) <=
+             budget &&
+         height < ds_height) {
+    ++height;
+  }
+  height = std::min(height, ds_height);
+
+  explanation << "tiles of at most " << width << " x " << height
+              << " cells keep their front and back buffers, halo of " << halo
+              << " included, within half of L2 ("
+              << format_bytes(
+                     buffer_bytes(width, height, halo, cell_bytes, line_bytes))
+              << " of " << format_bytes(budget) << ")\n";
+
+  // more, smaller tiles while there are too few to keep every thread busy
+
+  const int wanted = tiles_per_thread * num_threads;
+  const int initial_width = width;
+  const int initial_height = height;
+
+  while (count(ds_width, width) * count(ds_height, height) < wanted) {
+    if (height > min_side && (height >= width || width <= min_side)) {
+      height = std::max(min_side, height / 2);
+    } else if (width > min_side) {
+      width = std::max(min_side, width / 2 / line_cells * line_cells);
+    } else {
+      break;
+    }
+  }
+
+  width = fit(ds_width, width, halo);
+  height = fit(ds_height, height, halo);
+
+  const int tiles_per_row = count(ds_width, width);
+  const int tile_rows = count(ds_height, height);
+  const std::size_t tile_count =
+      static_cast<std::size_t>(tiles_per_row) * tile_rows;
+
+  if (width != initial_width || height != initial_height) {
+    explanation << "shrunk to " << width << " x " << height
+                << " cells, to fit the dataset and the halo or to have "
+                << tiles_per_thread << " tiles per thread\n";
+  }
+
+  explanation << tile_count << " tiles for " << num_threads << " threads";
+  if (static_cast<int>(tile_count) < wanted) {
+    explanation << ", fewer than " << tiles_per_thread
+                << " per thread as the dataset is small";
+  }
+  explanation << '\n';
+
+  // Stripes are as short as they can be while still giving every thread
+  // its share of tiles, so that a stripe at a time stays small.
+
+  const int rows_per_stripe =
+      std::clamp(count(wanted, tiles_per_row), 1, tile_rows);
+  const int stripe_height = rows_per_stripe * height;
+
+  partition_plan plan = {.tile_width = width,
+                         .tile_height = height,
+                         .tile_bytes = buffer_bytes(width, height, halo,
+                                                    cell_bytes, line_bytes),
+                         .tile_count = tile_count};
+
+  for (int y = 0; y < ds_height; y += stripe_height) {
+    plan.stripes.push_back({y, std::min(stripe_height, ds_height - y)});
+  }
+
+  // a last stripe shorter than a tile joins the one above it
+  if (plan.stripes.size() > 1 && plan.stripes.back().height < height) {
+    const int rest = plan.stripes.back().height;
+    plan.stripes.pop_back();
+    plan.stripes.back().height += rest;
+  }
+
+  const std::size_t stripe_bytes =
+      plan.tile_bytes * tiles_per_row * rows_per_stripe;
+  explanation << plan.stripes.size() << " stripes of " << rows_per_stripe
+              << (rows_per_stripe == 1 ? " tile row (" : " tile rows (")
+              << stripe_height << " cells), "
+              << format_bytes(stripe_bytes) << " each, "
+              << (stripe_bytes <= caches.l3_bytes ? "within" : "beyond")
+              << " L3\n";
+
+  plan.explanation = explanation.str();
+  return plan;
+}
+
+partition_plan plan_partition(int ds_width, int ds_height,
+                              std::size_t cell_bytes, int halo,
+                              const executor &exec) {
+  return plan_partition(ds_width, ds_height, cell_bytes, halo,
+                        exec.get_num_threads(), read_cache_topology());
+}
+
+} // namespace praster
@@ -1,42 +1,111 @@
 #include "stripe.h"
+#include "executor.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <exception>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 
 namespace praster {
 
-stripe::stripe(
-    int stripe_number, int y, int width, int height, int top_margin,
-    int bottom_margin, double nodata, int tile_width, int tile_height,
-    std::function<void(int x, int y, int width, int height, double *buffer)>
-        callback)
+namespace {
+
+// Sums the stats of the exchanges of every tile, counting each tile once
+// however many exchanges it took part in.
+exchange_stats summarize(const std::vector<exchange_stats> &tile_stats) {
+  exchange_stats stats = {.tiles = tile_stats.size()};
+  for (const exchange_stats &s : tile_stats) {
+    stats.active_tiles += s.copied_edges > 0 ? 1 : 0;
+    stats.edges += s.edges;
+    stats.copied_edges += s.copied_edges;
+  }
+  return stats;
+}
+
+// Returns the node of the executor a stripe is placed on, or -1 if any.
+int placed_node(int numa_node, const executor &exec) {
+  return numa_node < 0 ? -1 : numa_node % exec.get_num_nodes();
+}
+
+// Runs the step for every index of the lists, one list per node of the
+// executor, those of a list on the threads of its node a chunk at a time.
+// Returns once all are done.
+void for_each_on_nodes(
+    executor &exec, const std::vector<std::vector<std::size_t>> &lists,
+    const std::function<void(executor::context, std::size_t)> &step) {
+  assert(static_cast<int>(lists.size()) == exec.get_num_nodes());
+
+  std::vector<std::atomic<std::size_t>> next(lists.size());
+  const std::size_t chunks = 4 * static_cast<std::size_t>(
+                                     std::max(1, exec.get_num_threads()));
+
+  exec.broadcast(
+      [&](executor::context ctx) {
+        const std::vector<std::size_t> &list = lists[ctx.executor_node];
+        const std::size_t chunk = std::max<std::size_t>(
+            1, list.size() / chunks);
+        for (std::size_t begin = next[ctx.executor_node].fetch_add(chunk);
+             begin < list.size();
+             begin = next[ctx.executor_node].fetch_add(chunk)) {
+          const std::size_t end = std::min(begin + chunk, list.size());
+          for (std::size_t i = begin; i < end; ++i) {
+            step(ctx, list[i]);
+          }
+        }
+      },
+      true);
+}
+
+// Splits the indices below count among the nodes of the executor, each
+// index going to its node if it has one and otherwise to the node of the
+// contiguous block it falls in.
+std::vector<std::vector<std::size_t>>
+split_among_nodes(std::size_t count, const executor &exec,
+                  const std::function<int(std::size_t)> &node_of) {
+  const std::size_t num_nodes = exec.get_num_nodes();
+  std::vector<std::vector<std::size_t>> lists(num_nodes);
+  for (std::size_t i = 0; i < count; ++i) {
+    const int node = node_of(i);
+    lists[node >= 0 ? node : i * num_nodes / count].push_back(i);
+  }
+  return lists;
+}
+
+} // namespace
+
+template <pixel_type T>
+basic_stripe<T>::basic_stripe(int stripe_number, int y, int width, int height,
+                              int top_margin, int bottom_margin, T nodata,
+                              int tile_width, int tile_height,
+                              read_callback callback,
+                              const stripe_options &options, executor *exec)
     : m_stripe_number(stripe_number), m_y(y), m_width(width), m_height(height),
       m_top_margin(top_margin), m_bottom_margin(bottom_margin),
-      m_nodata(nodata), m_tile_width(tile_width), m_tile_height(tile_height) {
+      m_halo(options.halo), m_pad_edges(options.pad_edges),
+      m_allocator(options.allocator ? options.allocator : default_allocator()),
+      m_double_buffered(options.double_buffered),
+      m_memory_budget(options.memory_budget),
+      m_numa_node(options.numa_node), m_nodata(nodata),
+      m_tile_width(tile_width), m_tile_height(tile_height) {
 
   m_tile_ysize =
       m_height / m_tile_height + (m_height % m_tile_height != 0 ? 1 : 0);
   m_tile_xsize = m_width / m_tile_width + (m_width % m_tile_width != 0 ? 1 : 0);
 
+  std::vector<tile_layout> layouts;
+
   int tile_index = 0;
   for (int y_id = 0; y_id < m_tile_ysize; ++y_id) {
     for (int x_id = 0; x_id < m_tile_xsize; ++x_id) {
-      const int tile_left_margin = (x_id != 0 && m_tile_xsize != 1) ? 1 : 0;
-      const int tile_right_margin =
-          (x_id != m_tile_xsize - 1 && m_tile_xsize != 1) ? 1 : 0;
-
-      const int tile_top_margin =
-          (y_id != 0 && m_tile_ysize != 1) || (y_id == 0 && top_margin) ? 1 : 0;
-
-      const int tile_bottom_margin =
-          (y_id != m_tile_ysize - 1 && m_tile_ysize != 1) ||
-                  (y_id == m_tile_ysize - 1 && bottom_margin)
-              ? 1
-              : 0;
+      // sides along the dataset edges have no neighbour to exchange with
 
-      const int x = x_id * tile_width;
-      const int y = m_y + y_id * tile_height;
+      const bool left_edge = x_id == 0;
+      const bool right_edge = x_id == m_tile_xsize - 1;
+      const bool top_edge = y_id == 0 && top_margin == 0;
+      const bool bottom_edge = y_id == m_tile_ysize - 1 && bottom_margin == 0;
 
       const int exact_tile_width =
           x_id == m_tile_xsize - 1 ? (m_width - (m_tile_xsize - 1) * tile_width)
@@ -45,11 +114,24 @@ stripe::stripe(
           y_id == m_tile_ysize - 1
               ? (m_height - (m_tile_ysize - 1) * tile_height)
               : tile_height;
-      tile t = tile(x, y, exact_tile_width, exact_tile_height, tile_left_margin,
-                    tile_right_margin, tile_top_margin, tile_bottom_margin,
-                    m_nodata, callback);
 
-      m_tiles.push_back(std::move(t));
+      // the padding stays nodata, only the part of the buffer inside the
+      // dataset is read
+
+      layouts.push_back({
+          .x = x_id * tile_width,
+          .y = m_y + y_id * tile_height,
+          .width = exact_tile_width,
+          .height = exact_tile_height,
+          .left_margin = !left_edge || m_pad_edges ? m_halo : 0,
+          .right_margin = !right_edge || m_pad_edges ? m_halo : 0,
+          .top_margin = !top_edge || m_pad_edges ? m_halo : 0,
+          .bottom_margin = !bottom_edge || m_pad_edges ? m_halo : 0,
+          .pad_left = m_pad_edges && left_edge ? m_halo : 0,
+          .pad_right = m_pad_edges && right_edge ? m_halo : 0,
+          .pad_top = m_pad_edges && top_edge ? m_halo : 0,
+          .pad_bottom = m_pad_edges && bottom_edge ? m_halo : 0,
+      });
 
       if (y_id == 0) {
         m_top_margin_indices.push_back(tile_index);
@@ -62,13 +144,172 @@ stripe::stripe(
       ++tile_index;
     }
   }
+
+  // The stripe window, margin rows included, is read at once and the tiles
+  // copy their cells from it, instead of each reading its own rectangle.
+
+  std::vector<T> window;
+  if (options.coalesced_read) {
+    const int window_height = m_height + m_top_margin + m_bottom_margin;
+
+    window.resize(static_cast<std::size_t>(m_width) * window_height);
+    callback(0, m_y - m_top_margin, m_width, window_height, window.data());
+  }
+  const T *window_data = window.empty() ? nullptr : window.data();
+
+  m_tiles.reserve(layouts.size());
+  m_last_use.reserve(layouts.size());
+
+  if (exec == nullptr) {
+    for (const tile_layout &layout : layouts) {
+      m_tiles.push_back(load_tile(layout, callback, window_data));
+
+      // tiles beyond the budget are compressed while the stripe is read
+      m_last_use.push_back(++m_clock);
+      enforce_budget();
+    }
+    return;
+  }
+
+  // The threads take the next tile to read until a wave of tiles is read.
+  // Under a memory budget a wave is as many tiles as threads, the budget
+  // being enforced between waves; otherwise it is the whole stripe. A
+  // stripe placed on a node is read by the threads of that node alone,
+  // which first touch, and so place, the pages of its tiles.
+
+  const int node = placed_node(m_numa_node, *exec);
+
+  const std::size_t wave = m_memory_budget != 0
+                               ? static_cast<std::size_t>(
+                                     std::max(1, exec->get_num_threads()))
+                               : layouts.size();
+
+  for (std::size_t begin = 0; begin < layouts.size(); begin += wave) {
+    const std::size_t end = std::min(begin + wave, layouts.size());
+
+    std::vector<std::optional<tile_type>> loaded(end - begin);
+    std::atomic<std::size_t> next{begin};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    exec->broadcast(
+        [&](executor::context ctx) {
+          if (node >= 0 && ctx.executor_node != node) {
+            return;
+          }
+
+          for (std::size_t i = next++; i < end; i = next++) {
+            try {
+              loaded[i - begin].emplace(
+                  load_tile(layouts[i], callback, window_data));
+            } catch (...) {
+              std::lock_guard<std::mutex> lock(error_mutex);
+              if (!error) {
+                error = std::current_exception();
+              }
+              next = end;
+            }
+          }
+        },
+        true);
+
+    if (error) {
+      std::rethrow_exception(error);
+    }
+
+    for (std::optional<tile_type> &t : loaded) {
+      m_tiles.push_back(std::move(*t));
+      m_last_use.push_back(++m_clock);
+    }
+    enforce_budget();
+  }
 }
 
-stripe stripe::build(
-    int partition_number, int y, int height, int ds_width, int ds_height,
-    double nodata, int tile_width, int tile_height,
-    std::function<void(int x, int y, int width, int height, double *buffer)>
-        callback) {
+template <pixel_type T>
+typename basic_stripe<T>::tile_type
+basic_stripe<T>::load_tile(const tile_layout &layout,
+                           const read_callback &callback,
+                           const T *window) const {
+  if (!m_pad_edges && window == nullptr) {
+    tile_type t = tile_type(layout.x, layout.y, layout.width, layout.height,
+                            layout.left_margin, layout.right_margin,
+                            layout.top_margin, layout.bottom_margin, m_nodata,
+                            callback, m_allocator);
+    if (m_double_buffered) {
+      t.add_back_buffer();
+    }
+    return t;
+  }
+
+  tile_type t = tile_type(layout.x, layout.y, layout.width, layout.height,
+                          layout.left_margin, layout.right_margin,
+                          layout.top_margin, layout.bottom_margin, m_nodata,
+                          m_allocator);
+
+  // the part of the buffer inside the dataset
+  const int x = layout.x - layout.left_margin + layout.pad_left;
+  const int y = layout.y - layout.top_margin + layout.pad_top;
+  const int width = layout.width + layout.left_margin + layout.right_margin -
+                    layout.pad_left - layout.pad_right;
+  const int height = layout.height + layout.top_margin +
+                     layout.bottom_margin - layout.pad_top -
+                     layout.pad_bottom;
+
+  if (m_pad_edges) {
+    t.fill(m_nodata);
+  }
+
+  if (window != nullptr) {
+    const typename tile_type::view_type buffer = t.get_view(true);
+    for (int i = 0; i < height; ++i) {
+      const T *from =
+          window +
+          static_cast<std::size_t>(y - (m_y - m_top_margin) + i) * m_width +
+          x;
+      std::copy(from, from + width,
+                buffer.row(layout.pad_top + i).data() + layout.pad_left);
+    }
+  } else {
+    t.read(callback, x, y, width, height);
+  }
+  t.compact();
+
+  if (m_double_buffered) {
+    t.add_back_buffer();
+  }
+  return t;
+}
+
+template <pixel_type T>
+basic_stripe<T> basic_stripe<T>::build(int partition_number, int y,
+                                       int height, int ds_width, int ds_height,
+                                       T nodata, int tile_width,
+                                       int tile_height, read_callback callback,
+                                       const stripe_options &options) {
+  return build(partition_number, y, height, ds_width, ds_height, nodata,
+               tile_width, tile_height, std::move(callback), options, nullptr);
+}
+
+template <pixel_type T>
+basic_stripe<T> basic_stripe<T>::build(int partition_number, int y,
+                                       int height, int ds_width, int ds_height,
+                                       T nodata, int tile_width,
+                                       int tile_height, read_callback callback,
+                                       executor &exec,
+                                       const stripe_options &options) {
+  return build(partition_number, y, height, ds_width, ds_height, nodata,
+               tile_width, tile_height, std::move(callback), options, &exec);
+}
+
+template <pixel_type T>
+basic_stripe<T> basic_stripe<T>::build(int partition_number, int y,
+                                       int height, int ds_width, int ds_height,
+                                       T nodata, int tile_width,
+                                       int tile_height, read_callback callback,
+                                       const stripe_options &options,
+                                       executor *exec) {
+  const int halo = options.halo;
+
   if (tile_width > ds_width) {
     throw std::invalid_argument("stripe: m_tile_width > m_width");
   }
@@ -81,31 +322,163 @@ stripe stripe::build(
     throw std::invalid_argument("stripe: m_y + m_height > ds_height");
   }
 
-  int top_margin{1};
+  if (halo < 0) {
+    throw std::invalid_argument("stripe: halo < 0");
+  }
+
+  // every tile, including the narrower last one of each row and column, has
+  // to cover the whole halo of its neighbours
+
+  const int last_tile_width = ds_width % tile_width != 0
+                                  ? ds_width % tile_width
+                                  : tile_width;
+  const int last_tile_height =
+      height % tile_height != 0 ? height % tile_height : tile_height;
+
+  if ((ds_width > tile_width && last_tile_width < halo) ||
+      (height > tile_height && last_tile_height < halo) ||
+      std::min(tile_width, tile_height) < halo) {
+    throw std::invalid_argument("stripe: tile smaller than halo");
+  }
+
+  if ((y != 0 && y < halo) ||
+      (y + height != ds_height && y + height + halo > ds_height)) {
+    throw std::invalid_argument("stripe: neighbour stripe smaller than halo");
+  }
+
+  int top_margin{halo};
   if (y == 0) {
     top_margin = 0;
   }
 
-  int bottom_margin{1};
+  int bottom_margin{halo};
   if (y + height == ds_height) {
     bottom_margin = 0;
   }
 
-  return stripe(partition_number, y, ds_width, height, top_margin,
-                bottom_margin, nodata, tile_width, tile_height, callback);
+  return basic_stripe(partition_number, y, ds_width, height, top_margin,
+                      bottom_margin, nodata, tile_width, tile_height, callback,
+                      options, exec);
+}
+
+template <pixel_type T>
+void basic_stripe<T>::write(const write_callback &callback) const {
+  for (const tile_type &t : m_tiles) {
+    t.write(callback);
+  }
 }
 
-void stripe::update_borders(stripe *top_stripe, stripe *bottom_stripe) {
+template <pixel_type T>
+typename basic_stripe<T>::tile_type &
+basic_stripe<T>::resident(std::size_t index) {
+  m_tiles[index].decompress();
+  m_last_use[index] = ++m_clock;
+  return m_tiles[index];
+}
+
+template <pixel_type T> void basic_stripe<T>::enforce_budget() {
+  if (m_memory_budget == 0) {
+    return;
+  }
+
+  std::size_t bytes = get_memory_bytes();
+  while (bytes > m_memory_budget) {
+    std::size_t oldest = m_tiles.size();
+    for (std::size_t i = 0; i < m_tiles.size(); ++i) {
+      if (m_tiles[i].has_buffer() && !m_tiles[i].is_compact() &&
+          m_last_use[i] != m_clock &&
+          (oldest == m_tiles.size() || m_last_use[i] < m_last_use[oldest])) {
+        oldest = i;
+      }
+    }
+
+    if (oldest == m_tiles.size()) {
+      return;
+    }
+
+    bytes -= m_tiles[oldest].get_memory_bytes();
+    m_tiles[oldest].compress();
+    bytes += m_tiles[oldest].get_memory_bytes();
+  }
+}
+
+template <pixel_type T>
+typename basic_stripe<T>::tile_type &
+basic_stripe<T>::get_tile(std::size_t index) {
+  tile_type &t = resident(index);
+  enforce_budget();
+  return t;
+}
+
+template <pixel_type T> void basic_stripe<T>::compress() {
+  for (tile_type &t : m_tiles) {
+    t.compress();
+  }
+}
+
+template <pixel_type T>
+std::size_t basic_stripe<T>::get_memory_bytes() const noexcept {
+  std::size_t bytes = 0;
+  for (const tile_type &t : m_tiles) {
+    bytes += t.get_memory_bytes();
+  }
+  return bytes;
+}
+
+template <pixel_type T>
+tile_statistics<T> basic_stripe<T>::get_statistics() const {
+  tile_statistics<T> stats;
+  for (const tile_type &t : m_tiles) {
+    stats.merge(t.get_statistics());
+  }
+  return stats;
+}
+
+template <pixel_type T>
+tile_statistics<T> basic_stripe<T>::get_statistics(executor &exec) const {
+  const int num_threads = exec.get_num_threads();
+  std::vector<tile_statistics<T>> partial(num_threads);
+
+  // every thread summarizes the tiles it takes, each tile by a single thread
+
+  const int node = placed_node(m_numa_node, exec);
+  for_each_on_nodes(exec,
+                    split_among_nodes(m_tiles.size(), exec,
+                                      [node](std::size_t) { return node; }),
+                    [&](executor::context ctx, std::size_t i) {
+                      partial[ctx.task_num].merge(m_tiles[i].get_statistics());
+                    });
+
+  tile_statistics<T> stats;
+  for (const tile_statistics<T> &p : partial) {
+    stats.merge(p);
+  }
+  return stats;
+}
+
+template <pixel_type T> void basic_stripe<T>::swap_buffers() noexcept {
+  for (tile_type &t : m_tiles) {
+    t.swap_buffers();
+  }
+}
+
+template <pixel_type T>
+exchange_stats basic_stripe<T>::update_borders(basic_stripe *top_stripe,
+                                               basic_stripe *bottom_stripe) {
+  std::vector<exchange_stats> tile_stats(m_tiles.size());
 
   // update borders located next to the top stripe
 
   if (top_stripe) {
     for (int i = 0; i < m_top_margin_indices.size(); ++i) {
-      tile *center_tile = &m_tiles[m_top_margin_indices[i]];
-      tile *top_tile =
-          &top_stripe->m_tiles[top_stripe->m_bottom_margin_indices[i]];
-      center_tile->update_borders(nullptr, top_tile, nullptr, nullptr, nullptr,
-                                  nullptr, nullptr, nullptr);
+      tile_type *center_tile = &resident(m_top_margin_indices[i]);
+      tile_type *top_tile =
+          &top_stripe->resident(top_stripe->m_bottom_margin_indices[i]);
+      tile_stats[m_top_margin_indices[i]].merge(center_tile->update_borders(
+          nullptr, top_tile, nullptr, nullptr, nullptr, nullptr, nullptr,
+          nullptr));
+      enforce_budget();
+      top_stripe->enforce_budget();
     }
   }
 
@@ -113,84 +486,249 @@ void stripe::update_borders(stripe *top_stripe, stripe *bottom_stripe) {
 
   if (bottom_stripe) {
     for (int i = 0; i < m_bottom_margin_indices.size(); ++i) {
-      tile *center_tile = &m_tiles[m_bottom_margin_indices[i]];
-      tile *bottom_tile =
-          &bottom_stripe->m_tiles[bottom_stripe->m_top_margin_indices[i]];
-      center_tile->update_borders(nullptr, nullptr, nullptr, nullptr, nullptr,
-                                  nullptr, bottom_tile, nullptr);
+      tile_type *center_tile = &resident(m_bottom_margin_indices[i]);
+      tile_type *bottom_tile =
+          &bottom_stripe->resident(bottom_stripe->m_top_margin_indices[i]);
+      tile_stats[m_bottom_margin_indices[i]].merge(
+          center_tile->update_borders(nullptr, nullptr, nullptr, nullptr,
+                                      nullptr, nullptr, bottom_tile, nullptr));
+      enforce_budget();
+      bottom_stripe->enforce_budget();
     }
   }
 
   // lastly update inner borders
 
-  tile *top_left_tile = nullptr;
-  tile *top_tile = nullptr;
-  tile *top_right_tile = nullptr;
-  tile *left_tile = nullptr;
-  tile *right_tile = nullptr;
-  tile *bottom_left_tile = nullptr;
-  tile *bottom_tile = nullptr;
-  tile *bottom_right_tile = nullptr;
-  tile *center_tile = nullptr;
+  tile_type *top_left_tile = nullptr;
+  tile_type *top_tile = nullptr;
+  tile_type *top_right_tile = nullptr;
+  tile_type *left_tile = nullptr;
+  tile_type *right_tile = nullptr;
+  tile_type *bottom_left_tile = nullptr;
+  tile_type *bottom_tile = nullptr;
+  tile_type *bottom_right_tile = nullptr;
+  tile_type *center_tile = nullptr;
 
   for (int y_id = 0; y_id < m_tile_ysize; ++y_id) {
     for (int x_id = 0; x_id < m_tile_xsize; ++x_id) {
 
-      center_tile = &m_tiles[compute_tile_index(y_id, x_id)];
+      center_tile = &resident(compute_tile_index(y_id, x_id));
 
       if (y_id > 0 && x_id > 0) {
-        top_left_tile = &m_tiles[compute_tile_index(y_id - 1, x_id - 1)];
+        top_left_tile = &resident(compute_tile_index(y_id - 1, x_id - 1));
       } else {
         top_left_tile = nullptr;
       }
 
       if (y_id > 0) {
-        top_tile = &m_tiles[compute_tile_index(y_id - 1, x_id)];
+        top_tile = &resident(compute_tile_index(y_id - 1, x_id));
       } else {
         top_tile = nullptr;
       }
 
       if (y_id > 0 && x_id < m_tile_xsize - 1) {
-        top_right_tile = &m_tiles[compute_tile_index(y_id - 1, x_id + 1)];
+        top_right_tile = &resident(compute_tile_index(y_id - 1, x_id + 1));
       } else {
         top_right_tile = nullptr;
       }
 
       if (x_id > 0) {
-        left_tile = &m_tiles[compute_tile_index(y_id, x_id - 1)];
+        left_tile = &resident(compute_tile_index(y_id, x_id - 1));
       } else {
         left_tile = nullptr;
       }
 
-      if (y_id > 0 && x_id < m_tile_xsize - 1) {
-        right_tile = &m_tiles[compute_tile_index(y_id, x_id + 1)];
+      if (x_id < m_tile_xsize - 1) {
+        right_tile = &resident(compute_tile_index(y_id, x_id + 1));
       } else {
         right_tile = nullptr;
       }
 
       if (x_id > 0 && y_id < m_tile_ysize - 1) {
-        bottom_left_tile = &m_tiles[compute_tile_index(y_id + 1, x_id - 1)];
+        bottom_left_tile = &resident(compute_tile_index(y_id + 1, x_id - 1));
       } else {
         bottom_left_tile = nullptr;
       }
 
       if (y_id < m_tile_ysize - 1) {
-        bottom_tile = &m_tiles[compute_tile_index(y_id + 1, x_id)];
+        bottom_tile = &resident(compute_tile_index(y_id + 1, x_id));
       } else {
         bottom_tile = nullptr;
       }
 
       if (x_id < m_tile_xsize - 1 && y_id < m_tile_ysize - 1) {
-        bottom_right_tile = &m_tiles[compute_tile_index(y_id + 1, x_id + 1)];
+        bottom_right_tile = &resident(compute_tile_index(y_id + 1, x_id + 1));
       } else {
         bottom_right_tile = nullptr;
       }
 
-      center_tile->update_borders(top_left_tile, top_tile, top_right_tile,
-                                  left_tile, right_tile, bottom_left_tile,
-                                  bottom_tile, bottom_right_tile);
+      tile_stats[compute_tile_index(y_id, x_id)].merge(
+          center_tile->update_borders(top_left_tile, top_tile,
+                                      top_right_tile, left_tile, right_tile,
+                                      bottom_left_tile, bottom_tile,
+                                      bottom_right_tile));
+      enforce_budget();
     }
   }
+
+  return summarize(tile_stats);
 }
 
+template <pixel_type T>
+exchange_stats
+basic_stripe<T>::update_borders(std::vector<basic_stripe> &stripes,
+                                executor &exec) {
+
+  // the tiles of all stripes as a single grid
+
+  std::vector<tile_type *> grid;
+  std::vector<int> grid_nodes;
+  int columns = 0;
+  for (basic_stripe &s : stripes) {
+    assert(columns == 0 || columns == s.m_tile_xsize);
+    columns = s.m_tile_xsize;
+    for (std::size_t i = 0; i < s.m_tiles.size(); ++i) {
+      s.m_last_use[i] = ++s.m_clock;
+      grid.push_back(&s.m_tiles[i]);
+      grid_nodes.push_back(placed_node(s.m_numa_node, exec));
+    }
+  }
+
+  if (grid.empty()) {
+    return {};
+  }
+
+  const int rows = static_cast<int>(grid.size()) / columns;
+  auto at = [&grid, rows, columns](int y_id, int x_id) -> tile_type * {
+    if (y_id < 0 || y_id >= rows || x_id < 0 || x_id >= columns) {
+      return nullptr;
+    }
+    return grid[y_id * columns + x_id];
+  };
+
+  // Every step hands the tiles of each stripe to the threads of its node,
+  // or of any node, in contiguous chunks, and returns once all of them are
+  // done, so the steps never overlap.
+
+  const std::vector<std::vector<std::size_t>> lists =
+      split_among_nodes(grid.size(), exec,
+                        [&grid_nodes](std::size_t i) { return grid_nodes[i]; });
+  auto for_each_tile = [&](const std::function<void(int, int)> &step) {
+    for_each_on_nodes(exec, lists,
+                      [&](executor::context, std::size_t i) {
+                        step(i / columns, i % columns);
+                      });
+  };
+
+  // borders not changed since the last exchange are skipped, which needs
+  // every interior stamped before any tile compares versions
+
+  for_each_tile([&](int y_id, int x_id) {
+    at(y_id, x_id)->decompress();
+    at(y_id, x_id)->stamp_interior();
+  });
+
+  // compact tiles about to receive other values are materialized up front
+
+  std::vector<char> materialized(grid.size(), false);
+  for_each_tile([&](int y_id, int x_id) {
+    const tile_type *t = at(y_id, x_id);
+    materialized[y_id * columns + x_id] =
+        t->is_compact() &&
+        !t->keeps_compact(at(y_id - 1, x_id - 1), at(y_id - 1, x_id),
+                          at(y_id - 1, x_id + 1), at(y_id, x_id - 1),
+                          at(y_id, x_id + 1), at(y_id + 1, x_id - 1),
+                          at(y_id + 1, x_id), at(y_id + 1, x_id + 1));
+  });
+
+  for_each_tile([&](int y_id, int x_id) {
+    if (materialized[y_id * columns + x_id]) {
+      at(y_id, x_id)->materialize();
+    }
+  });
+
+  std::vector<exchange_stats> tile_stats(grid.size());
+
+  for_each_tile([&](int y_id, int x_id) {
+    tile_stats[y_id * columns + x_id] = at(y_id, x_id)->update_side_borders(
+        at(y_id, x_id - 1), at(y_id, x_id + 1));
+  });
+
+  for_each_tile([&](int y_id, int x_id) {
+    tile_stats[y_id * columns + x_id].merge(at(y_id, x_id)->update_end_borders(
+        at(y_id - 1, x_id), at(y_id + 1, x_id)));
+  });
+
+  for (basic_stripe &s : stripes) {
+    s.enforce_budget();
+  }
+
+  return summarize(tile_stats);
+}
+
+template <pixel_type T>
+void basic_stripe<T>::scan(std::vector<basic_stripe> &stripes, executor &exec,
+                           ScanDirection direction,
+                           const std::function<void(tile_type &)> &kernel) {
+  std::vector<tile_type *> grid;
+  int columns = 0;
+  for (basic_stripe &s : stripes) {
+    assert(columns == 0 || columns == s.m_tile_xsize);
+    columns = s.m_tile_xsize;
+    for (std::size_t i = 0; i < s.m_tiles.size(); ++i) {
+      s.m_last_use[i] = ++s.m_clock;
+      grid.push_back(&s.m_tiles[i]);
+    }
+  }
+
+  if (grid.empty()) {
+    return;
+  }
+
+  const int rows = static_cast<int>(grid.size()) / columns;
+  const scan_step step = get_scan_step(direction);
+
+  // a neighbour only if the scan has already passed it
+  auto upstream = [&](int y_id, int x_id, int dy, int dx) -> tile_type * {
+    if ((dy != 0 && dy != -step.dy) || (dx != 0 && dx != -step.dx)) {
+      return nullptr;
+    }
+    y_id += dy;
+    x_id += dx;
+    if (y_id < 0 || y_id >= rows || x_id < 0 || x_id >= columns) {
+      return nullptr;
+    }
+    return grid[y_id * columns + x_id];
+  };
+
+  // The tiles upstream are done and no longer written, and those
+  // downstream wait, so a tile reads and writes without locks. It stamps
+  // its interior before it finishes, the tiles reading it then finding
+  // nothing left to stamp.
+
+  scan_grid(exec, rows, columns, direction, [&](int y_id, int x_id) {
+    tile_type &t = *grid[y_id * columns + x_id];
+    t.decompress();
+    t.update_borders(
+        upstream(y_id, x_id, -1, -1), upstream(y_id, x_id, -1, 0),
+        upstream(y_id, x_id, -1, 1), upstream(y_id, x_id, 0, -1),
+        upstream(y_id, x_id, 0, 1), upstream(y_id, x_id, 1, -1),
+        upstream(y_id, x_id, 1, 0), upstream(y_id, x_id, 1, 1));
+    kernel(t);
+    t.stamp_interior();
+  });
+
+  for (basic_stripe &s : stripes) {
+    s.enforce_budget();
+  }
+}
+
+template class basic_stripe<std::uint8_t>;
+template class basic_stripe<std::int16_t>;
+template class basic_stripe<std::uint16_t>;
+template class basic_stripe<std::int32_t>;
+template class basic_stripe<std::uint32_t>;
+template class basic_stripe<float>;
+template class basic_stripe<double>;
+
 } // namespace praster
\ No newline at end of file
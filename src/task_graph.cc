@@ -0,0 +1,82 @@
+#include "task_graph.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace praster {
+
+std::size_t task_graph::add(task t) {
+  m_nodes.push_back({.function = std::move(t)});
+  return m_nodes.size() - 1;
+}
+
+void task_graph::precede(std::size_t before, std::size_t after) {
+  if (before >= m_nodes.size() || after >= m_nodes.size()) {
+    throw std::invalid_argument("task_graph: no such task");
+  }
+
+  m_nodes[before].successors.push_back(after);
+  ++m_nodes[after].predecessors;
+}
+
+void task_graph::run(executor &exec) const {
+  // predecessors still to finish, counted down by each as it does
+  std::unique_ptr<std::atomic<int>[]> waiting(
+      new std::atomic<int>[m_nodes.size()]);
+  for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+    waiting[i] = m_nodes[i].predecessors;
+  }
+
+  std::atomic<std::size_t> finished{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  task_group group(exec);
+
+  // Runs the task, unless an earlier one failed, and releases those
+  // waiting for it. Successors are released even after a failure, so that
+  // every task is accounted for before run returns.
+  std::function<void(std::size_t)> launch = [&](std::size_t i) {
+    group.run([&, i](executor::context ctx) {
+      if (!failed) {
+        try {
+          m_nodes[i].function(ctx);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+          failed = true;
+        }
+      }
+
+      ++finished;
+      for (std::size_t successor : m_nodes[i].successors) {
+        if (waiting[successor].fetch_sub(1) == 1) {
+          launch(successor);
+        }
+      }
+    });
+  };
+
+  for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+    if (m_nodes[i].predecessors == 0) {
+      launch(i);
+    }
+  }
+  group.wait();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  if (finished != m_nodes.size()) {
+    throw std::logic_error("task_graph: dependencies form a cycle");
+  }
+}
+
+} // namespace praster
@@ -1,47 +1,408 @@
 #include "tile.h"
+#include "codec.h"
+#include "local_kernels.h"
+
+#include <algorithm>
+#include <atomic>
 
 namespace praster {
 
-tile::tile(int x, int y, int width, int height, int left_margin,
-           int right_margin, int top_margin, int bottom_margin, double nodata)
-    : m_x(x), m_y(y), m_width(width), m_height(height),
-      m_left_margin(left_margin), m_right_margin(right_margin),
-      m_top_margin(top_margin), m_bottom_margin(bottom_margin),
-      m_nodata(nodata) {
+namespace {
 
-  int width_with_margin = m_width + m_left_margin + m_right_margin;
-  int height_with_margin = m_height + m_top_margin + m_bottom_margin;
+// Returns a version number no tile used before.
+std::uint64_t next_version() noexcept {
+  static std::atomic<std::uint64_t> last_version{0};
+  return last_version.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+template <typename T> std::vector<T> copy_rows(tile_view<const T> view) {
+  std::vector<T> result;
+  result.reserve(view.size());
+  for (std::size_t y = 0; y < view.extent(0); ++y) {
+    std::span<const T> row = view.row(y);
+    result.insert(result.end(), row.begin(), row.end());
+  }
+  return result;
+}
+
+} // namespace
 
-  m_matrix = gsl_matrix_alloc(height_with_margin, width_with_margin);
+template <pixel_type T>
+basic_tile<T>::basic_tile(int x, int y, int width, int height,
+                          int left_margin, int right_margin, int top_margin,
+                          int bottom_margin, T nodata,
+                          buffer_allocator *allocator)
+    : m_allocator(allocator ? allocator : default_allocator()), m_x(x),
+      m_y(y), m_width(width), m_height(height), m_left_margin(left_margin),
+      m_right_margin(right_margin), m_top_margin(top_margin),
+      m_bottom_margin(bottom_margin), m_nodata(nodata) {
+
+  const std::size_t height_with_margin =
+      m_height + m_top_margin + m_bottom_margin;
+
+  m_stride = padded_stride(m_width + m_left_margin + m_right_margin);
+  m_data = static_cast<T *>(
+      m_allocator->allocate(height_with_margin * m_stride * sizeof(T)));
 }
 
-tile::tile(
-    int x, int y, int width, int height, int left_margin, int right_margin,
-    int top_margin, int bottom_margin, double nodata,
-    std::function<void(int x, int y, int width, int height, double *buffer)>
-        read_callback)
-    : tile(x, y, width, height, left_margin, right_margin, top_margin,
-           bottom_margin, nodata) {
+template <pixel_type T>
+basic_tile<T>::basic_tile(int x, int y, int width, int height,
+                          int left_margin, int right_margin, int top_margin,
+                          int bottom_margin, T nodata, read_callback callback,
+                          buffer_allocator *allocator)
+    : basic_tile(x, y, width, height, left_margin, right_margin, top_margin,
+                 bottom_margin, nodata, allocator) {
 
   int width_with_margin = m_width + m_left_margin + m_right_margin;
   int height_with_margin = m_height + m_top_margin + m_bottom_margin;
 
-  read_callback(m_x - m_left_margin, m_y - m_top_margin, width_with_margin,
-                height_with_margin, m_matrix->data);
+  read(callback, m_x - m_left_margin, m_y - m_top_margin, width_with_margin,
+       height_with_margin);
+  compact();
+}
+
+template <pixel_type T>
+std::size_t basic_tile<T>::padded_stride(int width) noexcept {
+  // Rows are padded to whole cache lines so that every row starts on one.
+  // Strides that are a multiple of 1 KiB map the cells of a column onto a
+  // handful of cache sets, which thrashes the cache when margins are copied
+  // column by column, so they get one more line.
+
+  constexpr std::size_t line = buffer_allocator::alignment;
+  constexpr std::size_t conflict = 1024;
+
+  std::size_t bytes = (width * sizeof(T) + line - 1) / line * line;
+  if (bytes % conflict == 0) {
+    bytes += line;
+  }
+  return bytes / sizeof(T);
+}
+
+template <pixel_type T> basic_tile<T>::~basic_tile() { free_buffer(); }
+
+template <pixel_type T>
+std::size_t basic_tile<T>::buffer_bytes() const noexcept {
+  const std::size_t width_with_margin =
+      m_width + m_left_margin + m_right_margin;
+
+  if (is_compact()) {
+    return padded_stride(width_with_margin) * sizeof(T);
+  }
+  return (m_height + m_top_margin + m_bottom_margin) * m_stride * sizeof(T);
+}
+
+template <pixel_type T> void basic_tile<T>::free_buffer() noexcept {
+  const std::size_t bytes = buffer_bytes();
+
+  if (m_data != nullptr) {
+    m_allocator->deallocate(m_data, bytes);
+    m_data = nullptr;
+  }
+
+  if (m_back_data != nullptr) {
+    m_allocator->deallocate(m_back_data, bytes);
+    m_back_data = nullptr;
+  }
+}
+
+template <pixel_type T> void basic_tile<T>::add_back_buffer() {
+  if (m_back_buffered) {
+    return;
+  }
+
+  m_back_buffered = true;
+  if (is_compact() || is_compressed()) {
+    return;
+  }
+
+  copy_to_back_buffer();
+}
+
+template <pixel_type T> void basic_tile<T>::copy_to_back_buffer() const {
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+  const int height_with_margin = m_height + m_top_margin + m_bottom_margin;
+
+  m_back_data = static_cast<T *>(m_allocator->allocate(
+      static_cast<std::size_t>(height_with_margin) * m_stride * sizeof(T)));
+
+  for (int y = 0; y < height_with_margin; ++y) {
+    const T *row = m_data + y * m_stride;
+    std::copy(row, row + width_with_margin, m_back_data + y * m_stride);
+  }
+}
+
+template <pixel_type T> bool basic_tile<T>::compact() {
+  if (is_compact()) {
+    return true;
+  }
+
+  make_resident();
+
+  const const_view_type buffer = std::as_const(*this).get_view(true);
+  const T value = buffer(0, 0);
+
+  for (std::size_t y = 0; y < buffer.extent(0); ++y) {
+    std::span<const T> row = buffer.row(y);
+    if (std::find_if(row.begin(), row.end(), [value](T cell) {
+          return cell != value;
+        }) != row.end()) {
+      update_validity_mask();
+      m_statistics = compute_statistics();
+      return false;
+    }
+  }
+
+  // keep one row, shared by all of them
+
+  const std::size_t width_with_margin = buffer.extent(1);
+  T *row = static_cast<T *>(m_allocator->allocate(
+      padded_stride(width_with_margin) * sizeof(T)));
+  std::fill(row, row + width_with_margin, value);
+
+  free_buffer();
+
+  m_data = row;
+  m_stride = 0;
+  m_state = value == m_nodata ? tile_state::empty : tile_state::uniform;
+  m_valid_mask.clear();
+  return true;
+}
+
+template <pixel_type T> void basic_tile<T>::materialize() {
+  if (!is_compact()) {
+    return;
+  }
+
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+  const std::size_t cells =
+      (m_height + m_top_margin + m_bottom_margin) *
+      padded_stride(width_with_margin);
+  const T value = *m_data;
+
+  T *data = static_cast<T *>(m_allocator->allocate(cells * sizeof(T)));
+  T *back_data = nullptr;
+  if (m_back_buffered) {
+    try {
+      back_data = static_cast<T *>(m_allocator->allocate(cells * sizeof(T)));
+    } catch (...) {
+      m_allocator->deallocate(data, cells * sizeof(T));
+      throw;
+    }
+  }
+
+  free_buffer();
+
+  // padding included, so that every row starts with defined cells
+  std::fill(data, data + cells, value);
+  if (back_data != nullptr) {
+    std::fill(back_data, back_data + cells, value);
+  }
+
+  m_data = data;
+  m_back_data = back_data;
+  m_stride = padded_stride(width_with_margin);
+  m_state = tile_state::mixed;
+}
+
+template <pixel_type T> void basic_tile<T>::compress() {
+  if (is_compact() || is_compressed() || m_data == nullptr) {
+    return;
+  }
+
+  m_compressed = codec::compress(
+      m_data, m_height + m_top_margin + m_bottom_margin,
+      m_width + m_left_margin + m_right_margin, m_stride);
+
+  free_buffer();
+  m_encoded.store(true, std::memory_order_release);
+}
+
+template <pixel_type T> void basic_tile<T>::decompress() { make_resident(); }
+
+template <pixel_type T> void basic_tile<T>::decode() const {
+  std::lock_guard<std::mutex> lock(m_decode_mutex);
+
+  // another thread may have decoded the tile meanwhile
+  if (!is_compressed()) {
+    return;
+  }
+
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+  const int height_with_margin = m_height + m_top_margin + m_bottom_margin;
+  const std::size_t bytes =
+      static_cast<std::size_t>(height_with_margin) * m_stride * sizeof(T);
+
+  T *data = static_cast<T *>(m_allocator->allocate(bytes));
+  codec::decompress(m_compressed, data, height_with_margin, width_with_margin,
+                    m_stride);
+
+  m_data = data;
+  std::vector<std::byte>().swap(m_compressed);
+
+  if (m_back_buffered) {
+    copy_to_back_buffer();
+  }
+
+  // publishes the buffers to the threads reading without the lock
+  m_encoded.store(false, std::memory_order_release);
 }
 
-tile::~tile() {
-  if (m_matrix != nullptr) {
-    gsl_matrix_free(m_matrix);
-    m_matrix = nullptr;
+template <pixel_type T>
+std::size_t basic_tile<T>::get_memory_bytes() const noexcept {
+  // a const accessor on another thread may be decoding the tile
+  std::lock_guard<std::mutex> lock(m_decode_mutex);
+
+  if (is_compressed()) {
+    return m_compressed.size();
   }
+
+  const std::size_t bytes = m_data != nullptr ? buffer_bytes() : 0;
+  return m_back_data != nullptr ? 2 * bytes : bytes;
 }
 
-tile::tile(tile &&other) noexcept { *this = std::move(other); }
+template <pixel_type T> void basic_tile<T>::update_validity_mask() {
+  const std::size_t words = (m_width + 63) / 64;
+  m_valid_mask.assign(words * m_height, 0);
+
+  for (int y = 0; y < m_height; ++y) {
+    const T *row = row_data(y);
+    std::uint64_t *mask = m_valid_mask.data() + y * words;
+    for (int x = 0; x < m_width; ++x) {
+      mask[x / 64] |= std::uint64_t{row[x] != m_nodata} << (x % 64);
+    }
+  }
+}
+
+template <pixel_type T> std::size_t basic_tile<T>::count_valid() const {
+  switch (m_state) {
+  case tile_state::empty:
+    return 0;
+  case tile_state::uniform:
+    return static_cast<std::size_t>(m_width) * m_height;
+  default:
+    break;
+  }
+
+  std::size_t count = 0;
+  if (!m_valid_mask.empty()) {
+    for (std::uint64_t bits : m_valid_mask) {
+      count += std::popcount(bits);
+    }
+    return count;
+  }
+
+  make_resident();
+  for (int y = 0; y < m_height; ++y) {
+    const T *row = row_data(y);
+    count += std::count_if(row, row + m_width,
+                           [this](T cell) { return cell != m_nodata; });
+  }
+  return count;
+}
+
+template <pixel_type T>
+const tile_statistics<T> &basic_tile<T>::get_statistics() const {
+  if (!m_statistics) {
+    m_statistics = compute_statistics();
+  }
+  return *m_statistics;
+}
+
+template <pixel_type T>
+tile_statistics<T> basic_tile<T>::compute_statistics() const {
+  tile_statistics<T> stats;
+  const std::size_t cells = static_cast<std::size_t>(m_width) * m_height;
+
+  // compact tiles need no pass at all
+
+  if (m_state == tile_state::empty) {
+    stats.nodata_count = cells;
+    return stats;
+  }
+
+  if (m_state == tile_state::uniform) {
+    stats.count = cells;
+    stats.min = stats.max = *m_data;
+    stats.sum = static_cast<double>(*m_data) * cells;
+    return stats;
+  }
+
+  const local::kernel_table<T> &table = local::active_kernels<T>();
+
+  if (is_compressed()) {
+    const std::vector<T> interior = to_vector(false);
+    table.statistics(interior.data(), interior.size(), m_nodata, stats);
+    return stats;
+  }
+
+  for (int y = 0; y < m_height; ++y) {
+    table.statistics(row_data(y), m_width, m_nodata, stats);
+  }
+  return stats;
+}
+
+template <pixel_type T> void basic_tile<T>::fill_interior(T value) {
+  for (int y = 0; y < m_height; ++y) {
+    T *row = row_data(y);
+    std::fill(row, row + m_width, value);
+  }
+}
+
+template <pixel_type T>
+void basic_tile<T>::check_stencil_margins(int radius) const {
+  if (std::min({m_left_margin, m_right_margin, m_top_margin,
+                m_bottom_margin}) < radius) {
+    throw std::logic_error("tile: margins narrower than stencil radius");
+  }
+}
+
+template <pixel_type T>
+typename gsl_traits<T>::view basic_tile<T>::get_gsl_view() {
+  make_writable();
+  invalidate_margins();
+  return gsl_traits<T>::view_array_with_tda(
+      m_data, m_height + m_top_margin + m_bottom_margin,
+      m_width + m_left_margin + m_right_margin, m_stride);
+}
+
+template <pixel_type T>
+typename gsl_traits<T>::const_view
+basic_tile<T>::get_gsl_view() const {
+  // the rows of a compact tile share one stride-0 buffer, which GSL rejects
+  if (is_compact()) {
+    throw std::logic_error("tile: GSL view of a compact tile");
+  }
+  make_resident();
+  return gsl_traits<T>::const_view_array_with_tda(
+      m_data, m_height + m_top_margin + m_bottom_margin,
+      m_width + m_left_margin + m_right_margin, m_stride);
+}
+
+template <pixel_type T>
+basic_tile<T>::basic_tile(basic_tile &&other) noexcept {
+  *this = std::move(other);
+}
 
-tile &tile::operator=(tile &&other) noexcept {
+template <pixel_type T>
+basic_tile<T> &basic_tile<T>::operator=(basic_tile &&other) noexcept {
   if (this != &other) {
-    m_matrix = other.m_matrix;
+    free_buffer();
+
+    m_data = other.m_data;
+    m_back_data = other.m_back_data;
+    m_back_buffered = other.m_back_buffered;
+    m_state = other.m_state;
+    m_valid_mask = std::move(other.m_valid_mask);
+    m_compressed = std::move(other.m_compressed);
+    m_encoded.store(other.m_encoded.load());
+    m_statistics = std::move(other.m_statistics);
+    m_interior_changed = other.m_interior_changed;
+    m_interior_version = other.m_interior_version;
+    m_side_version = other.m_side_version;
+    m_end_version = other.m_end_version;
+    m_copied_versions = other.m_copied_versions;
+    m_stride = other.m_stride;
+    m_allocator = other.m_allocator;
 
     m_left_margin = other.m_left_margin;
     m_right_margin = other.m_right_margin;
@@ -57,7 +418,16 @@ tile &tile::operator=(tile &&other) noexcept {
 
     m_nodata = other.m_nodata;
 
-    other.m_matrix = nullptr;
+    other.m_data = nullptr;
+    other.m_back_data = nullptr;
+    other.m_back_buffered = false;
+    other.m_state = tile_state::mixed;
+    other.m_valid_mask.clear();
+    other.m_compressed.clear();
+    other.m_encoded.store(false);
+    other.m_statistics.reset();
+    other.m_stride = 0;
+    other.m_allocator = nullptr;
 
     other.m_left_margin = 0;
     other.m_right_margin = 0;
@@ -71,196 +441,534 @@ tile &tile::operator=(tile &&other) noexcept {
     other.m_width = 0;
     other.m_height = 0;
 
-    other.m_nodata = 0.0;
+    other.m_nodata = T{};
   }
   return *this;
 }
 
-std::vector<double> tile::to_vector(bool with_border) {
-  if (with_border) {
-    std::vector<double> result;
-    for (int y = 0; y < m_height + m_top_margin + m_bottom_margin; ++y) {
-      for (int x = 0; x < m_width + m_left_margin + m_right_margin; ++x) {
-        result.push_back(gsl_matrix_get(m_matrix, y, x));
+template <pixel_type T>
+std::vector<T> basic_tile<T>::to_vector(bool with_border) const {
+  {
+    // compressed cells are decoded into a scratch buffer, the tile stays as
+    // it is; the lock keeps a const accessor on another thread from decoding
+    // the tile, and freeing the cells, meanwhile
+    std::lock_guard<std::mutex> lock(m_decode_mutex);
+
+    if (is_compressed()) {
+      const int width_with_margin = m_width + m_left_margin + m_right_margin;
+      const int height_with_margin = m_height + m_top_margin + m_bottom_margin;
+
+      std::vector<T> decoded(static_cast<std::size_t>(width_with_margin) *
+                             height_with_margin);
+      codec::decompress(m_compressed, decoded.data(), height_with_margin,
+                        width_with_margin, width_with_margin);
+
+      if (with_border) {
+        return decoded;
       }
+
+      const const_view_type buffer(decoded.data(), height_with_margin,
+                                   width_with_margin, width_with_margin);
+      return copy_rows(
+          buffer.subview(m_top_margin, m_left_margin, m_height, m_width));
     }
-    return result;
-  } else {
-    std::vector<double> result;
-    foreach ([&result](double val) { result.push_back(val); })
-      ;
-    return result;
   }
+
+  return copy_rows(get_view(with_border));
 }
 
-void tile::foreach (
-    std::function<void(const std::pair<int, int> &index)> callback) {
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      callback(std::make_pair(y, x));
-    }
+template <pixel_type T> void basic_tile<T>::fill(T value) {
+  make_resident();
+
+  // a compact tile only has its one row to fill
+
+  invalidate_summary();
+  invalidate_margins();
+
+  if (is_compact()) {
+    std::fill(m_data, m_data + m_width + m_left_margin + m_right_margin,
+              value);
+    m_state = value == m_nodata ? tile_state::empty : tile_state::uniform;
+    return;
+  }
+
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+  const int height_with_margin = m_height + m_top_margin + m_bottom_margin;
+
+  for (int y = 0; y < height_with_margin; ++y) {
+    T *row = cell_data(y, 0);
+    std::fill(row, row + width_with_margin, value);
   }
 }
 
-void tile::foreach (std::function<void(const int y, const int x)> callback) {
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      callback(y, x);
+template <pixel_type T>
+void basic_tile<T>::read(const read_callback &callback, int x, int y,
+                         int width, int height) {
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+  const int buffer_x = x - (m_x - m_left_margin);
+  const int buffer_y = y - (m_y - m_top_margin);
+
+  assert(buffer_x >= 0 && buffer_x + width <= width_with_margin);
+  assert(buffer_y >= 0 &&
+         buffer_y + height <= m_height + m_top_margin + m_bottom_margin);
+
+  make_writable();
+  invalidate_margins();
+
+  // Full buffer rows are read in place, packed, and then spread out to the
+  // row stride from the last row up, so that no row is overwritten before it
+  // is moved.
+
+  if (width == width_with_margin) {
+    T *base = cell_data(buffer_y, 0);
+    callback(x, y, width, height, base);
+
+    for (int i = height - 1; i > 0; --i) {
+      const T *from = base + static_cast<std::size_t>(i) * width;
+      std::copy_backward(from, from + width, cell_data(buffer_y + i, width));
     }
+    return;
+  }
+
+  std::vector<T> buffer(static_cast<std::size_t>(width) * height);
+  callback(x, y, width, height, buffer.data());
+
+  for (int i = 0; i < height; ++i) {
+    const T *from = buffer.data() + static_cast<std::size_t>(i) * width;
+    std::copy(from, from + width, cell_data(buffer_y + i, buffer_x));
   }
 }
 
-void tile::foreach (std::function<void(double val)> callback) {
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      callback(gsl_matrix_get(m_matrix, y + m_top_margin, x + m_left_margin));
+template <pixel_type T>
+void basic_tile<T>::write(const write_callback &callback) const {
+  // without row padding nor horizontal margins the interior is already
+  // contiguous
+
+  if (!is_compressed()) {
+    const const_view_type view = get_view();
+    if (view.is_contiguous()) {
+      callback(m_x, m_y, m_width, m_height, view.data_handle());
+      return;
     }
   }
+
+  std::vector<T> buffer = to_vector(false);
+  callback(m_x, m_y, m_width, m_height, buffer.data());
 }
 
-void tile::transform(std::function<double(double val)> callback) {
-  int y_index, x_index;
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      y_index = y + m_top_margin;
-      x_index = x + m_left_margin;
+template <pixel_type T>
+void basic_tile<T>::foreach (
+    std::function<void(const std::pair<int, int> &index)> callback) {
+  foreach<decltype(callback) &>(callback);
+}
 
-      gsl_matrix_set(m_matrix, y_index, x_index,
-                     callback(gsl_matrix_get(m_matrix, y_index, x_index)));
+template <pixel_type T>
+void basic_tile<T>::foreach (
+    std::function<void(const int y, const int x)> callback) {
+  foreach<decltype(callback) &>(callback);
+}
+
+template <pixel_type T>
+void basic_tile<T>::foreach (std::function<void(T val)> callback) {
+  foreach<decltype(callback) &>(callback);
+}
+
+template <pixel_type T>
+void basic_tile<T>::transform(std::function<T(T val)> callback) {
+  transform<decltype(callback) &>(callback);
+}
+
+template <pixel_type T>
+void basic_tile<T>::transform(
+    std::function<T(const int y, const int x, T val)> callback) {
+  transform<decltype(callback) &>(callback);
+}
+
+template <pixel_type T>
+void basic_tile<T>::transform(
+    std::function<T(const std::pair<int, int> &index, T val)> callback) {
+  transform<decltype(callback) &>(callback);
+}
+
+template <pixel_type T>
+bool basic_tile<T>::copy_cells(const basic_tile &source, int source_y,
+                               int source_x, int y, int x, int height,
+                               int width) {
+  make_resident();
+  source.make_resident();
+
+  // a compact tile keeps out blocks holding its own value
+
+  if (is_compact()) {
+    if (source.holds_only(*m_data, source_y, source_x, height, width)) {
+      return false;
     }
+    materialize();
   }
-}
 
-void tile::transform(
-    std::function<double(const int y, const int x, double val)> callback) {
-  int y_index, x_index;
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      y_index = y + m_top_margin;
-      x_index = x + m_left_margin;
+  // rows already holding the cells are only read, not written again
 
-      gsl_matrix_set(
-          m_matrix, y_index, x_index,
-          callback(y, x, gsl_matrix_get(m_matrix, y_index, x_index)));
+  bool changed = false;
+  for (int i = 0; i < height; ++i) {
+    const T *from = source.cell_data(source_y + i, source_x);
+    T *to = cell_data(y + i, x);
+    if (!std::equal(from, from + width, to)) {
+      std::copy(from, from + width, to);
+      changed = true;
     }
   }
+  return changed;
 }
 
-void tile::transform(
-    std::function<double(const std::pair<int, int> &index, double val)>
-        callback) {
-  int y_index, x_index;
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      y_index = y + m_top_margin;
-      x_index = x + m_left_margin;
+template <pixel_type T>
+bool basic_tile<T>::copy_border(border b, const basic_tile &source,
+                                std::uint64_t source_margins, int source_y,
+                                int source_x, int y, int x, int height,
+                                int width, exchange_stats &stats) {
+  ++stats.edges;
+
+  const border_version version = {.interior = source.m_interior_version,
+                                  .margins = source_margins};
+  if (m_copied_versions[b] == version) {
+    return false;
+  }
+
+  m_copied_versions[b] = version;
+  ++stats.copied_edges;
+  return copy_cells(source, source_y, source_x, y, x, height, width);
+}
 
-      gsl_matrix_set(m_matrix, y_index, x_index,
-                     callback(std::make_pair(y, x),
-                              gsl_matrix_get(m_matrix, y_index, x_index)));
+template <pixel_type T> void basic_tile<T>::stamp_interior() const noexcept {
+  if (m_interior_changed) {
+    m_interior_version = next_version();
+    m_interior_changed = false;
+  }
+}
+
+template <pixel_type T> void basic_tile<T>::invalidate_margins() noexcept {
+  m_copied_versions.fill({});
+  m_side_version = next_version();
+  m_end_version = next_version();
+}
+
+template <pixel_type T>
+bool basic_tile<T>::holds_only(T value, int y, int x, int height,
+                               int width) const {
+  make_resident();
+  for (int i = 0; i < height; ++i) {
+    const T *from = cell_data(y + i, x);
+    if (std::find_if(from, from + width, [value](T cell) {
+          return cell != value;
+        }) != from + width) {
+      return false;
     }
   }
+  return true;
 }
 
-void tile::update_borders(tile *top_left_tile, tile *top_tile,
-                          tile *top_right_tile, tile *left_tile,
-                          tile *right_tile, tile *bottom_left_tile,
-                          tile *bottom_tile, tile *bottom_right_tile) {
-  // update top border
+template <pixel_type T>
+exchange_stats
+basic_tile<T>::update_side_borders(const basic_tile *left_tile,
+                                   const basic_tile *right_tile) {
+  exchange_stats stats = {.tiles = 1};
+  bool changed = false;
+
+  // only interior cells are read, whatever the margins of the sources hold
+
+  if (left_tile) {
+    assert(m_left_margin > 0 && left_tile->m_width >= m_left_margin);
+
+    changed |= copy_border(
+        left_border, *left_tile, 0, left_tile->m_top_margin,
+        left_tile->m_left_margin + left_tile->m_width - m_left_margin,
+        m_top_margin, 0, m_height, m_left_margin, stats);
+  }
+
+  if (right_tile) {
+    assert(m_right_margin > 0 && right_tile->m_width >= m_right_margin);
+
+    changed |= copy_border(right_border, *right_tile, 0,
+                           right_tile->m_top_margin, right_tile->m_left_margin,
+                           m_top_margin, m_left_margin + m_width, m_height,
+                           m_right_margin, stats);
+  }
+
+  if (changed) {
+    m_side_version = next_version();
+  }
+  stats.active_tiles = stats.copied_edges > 0 ? 1 : 0;
+  return stats;
+}
+
+template <pixel_type T>
+exchange_stats
+basic_tile<T>::update_end_borders(const basic_tile *top_tile,
+                                  const basic_tile *bottom_tile) {
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+
+  exchange_stats stats = {.tiles = 1};
+  bool changed = false;
+
+  // full rows are read, the side margins of the sources included
+
   if (top_tile) {
-    assert(top_tile->m_bottom_margin == 1);
-    assert(m_top_margin == 1);
+    assert(m_top_margin > 0 && top_tile->m_height >= m_top_margin);
 
-    gsl_vector_view neighbour = gsl_matrix_row(
-        top_tile->m_matrix, top_tile->m_height + top_tile->m_top_margin - 1);
-    gsl_vector_view border = gsl_matrix_row(m_matrix, 0);
+    changed |= copy_border(
+        top_border, *top_tile, top_tile->m_side_version,
+        top_tile->m_top_margin + top_tile->m_height - m_top_margin, 0, 0, 0,
+        m_top_margin, width_with_margin, stats);
+  }
 
-    gsl_vector_memcpy(&border.vector, &neighbour.vector);
+  if (bottom_tile) {
+    assert(m_bottom_margin > 0 && bottom_tile->m_height >= m_bottom_margin);
+
+    changed |= copy_border(
+        bottom_border, *bottom_tile, bottom_tile->m_side_version,
+        bottom_tile->m_top_margin, 0, m_top_margin + m_height, 0,
+        m_bottom_margin, width_with_margin, stats);
+  }
+
+  if (changed) {
+    m_end_version = next_version();
+  }
+  stats.active_tiles = stats.copied_edges > 0 ? 1 : 0;
+  return stats;
+}
+
+template <pixel_type T>
+bool basic_tile<T>::keeps_compact(
+    const basic_tile *top_left_tile, const basic_tile *top_tile,
+    const basic_tile *top_right_tile, const basic_tile *left_tile,
+    const basic_tile *right_tile, const basic_tile *bottom_left_tile,
+    const basic_tile *bottom_tile, const basic_tile *bottom_right_tile) const {
+  if (!is_compact()) {
+    return false;
+  }
+
+  const T value = *m_data;
+
+  // the first phase copies interior cells of the tiles on either side
+
+  if (left_tile &&
+      !left_tile->holds_only(
+          value, left_tile->m_top_margin,
+          left_tile->m_left_margin + left_tile->m_width - m_left_margin,
+          m_height, m_left_margin)) {
+    return false;
+  }
+
+  if (right_tile &&
+      !right_tile->holds_only(value, right_tile->m_top_margin,
+                              right_tile->m_left_margin, m_height,
+                              m_right_margin)) {
+    return false;
+  }
+
+  // The second copies full rows of the tiles above and below, whose side
+  // margins then hold interior cells of the diagonal tiles or, if there is
+  // none, what they hold now.
+
+  auto end_holds_only = [this, value](const basic_tile *end, int y,
+                                      const basic_tile *end_left,
+                                      int end_left_y,
+                                      const basic_tile *end_right,
+                                      int end_right_y, int height) {
+    if (!end->holds_only(value, y, end->m_left_margin, height,
+                         end->m_width)) {
+      return false;
+    }
+
+    const bool left_holds_only =
+        end_left ? end_left->holds_only(value, end_left_y,
+                                        end_left->m_left_margin +
+                                            end_left->m_width - m_left_margin,
+                                        height, m_left_margin)
+                 : end->holds_only(value, y, 0, height, m_left_margin);
+
+    const bool right_holds_only =
+        end_right
+            ? end_right->holds_only(value, end_right_y,
+                                    end_right->m_left_margin, height,
+                                    m_right_margin)
+            : end->holds_only(value, y, end->m_left_margin + end->m_width,
+                              height, m_right_margin);
+
+    return left_holds_only && right_holds_only;
+  };
+
+  if (top_tile) {
+    auto last_rows = [this](const basic_tile *t) {
+      return t ? t->m_top_margin + t->m_height - m_top_margin : 0;
+    };
+
+    if (!end_holds_only(top_tile, last_rows(top_tile), top_left_tile,
+                        last_rows(top_left_tile), top_right_tile,
+                        last_rows(top_right_tile), m_top_margin)) {
+      return false;
+    }
   }
 
-  // update bottom border
   if (bottom_tile) {
-    assert(bottom_tile->m_top_margin == 1);
-    assert(m_bottom_margin == 1);
+    auto first_rows = [](const basic_tile *t) {
+      return t ? t->m_top_margin : 0;
+    };
+
+    if (!end_holds_only(bottom_tile, first_rows(bottom_tile),
+                        bottom_left_tile, first_rows(bottom_left_tile),
+                        bottom_right_tile, first_rows(bottom_right_tile),
+                        m_bottom_margin)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <pixel_type T>
+exchange_stats basic_tile<T>::update_borders(
+    basic_tile *top_left_tile, basic_tile *top_tile,
+    basic_tile *top_right_tile, basic_tile *left_tile, basic_tile *right_tile,
+    basic_tile *bottom_left_tile, basic_tile *bottom_tile,
+    basic_tile *bottom_right_tile) {
+  const int width_with_margin = m_width + m_left_margin + m_right_margin;
+  const int height_with_margin = m_height + m_top_margin + m_bottom_margin;
+
+  for (const basic_tile *t :
+       {top_left_tile, top_tile, top_right_tile, left_tile, right_tile,
+        bottom_left_tile, bottom_tile, bottom_right_tile}) {
+    if (t) {
+      t->stamp_interior();
+    }
+  }
+
+  exchange_stats stats = {.tiles = 1};
+  bool side_changed = false;
+  bool end_changed = false;
+
+  // Margins are filled from the interior cells of the neighbouring tiles
+  // adjacent to them, as many rows or columns as the margin is wide. Full
+  // rows and columns are copied, so a border also depends on the margins of
+  // its source running across it.
+
+  // update top border
+  if (top_tile) {
+    assert(m_top_margin > 0 && top_tile->m_bottom_margin > 0);
+    assert(top_tile->m_height >= m_top_margin);
 
-    gsl_vector_view neighbour = gsl_matrix_row(bottom_tile->m_matrix, 1);
-    gsl_vector_view border = gsl_matrix_row(m_matrix, m_height + m_top_margin);
+    end_changed |= copy_border(
+        top_border, *top_tile, top_tile->m_side_version,
+        top_tile->m_top_margin + top_tile->m_height - m_top_margin, 0, 0, 0,
+        m_top_margin, width_with_margin, stats);
+  }
 
-    gsl_vector_memcpy(&border.vector, &neighbour.vector);
+  // update bottom border
+  if (bottom_tile) {
+    assert(m_bottom_margin > 0 && bottom_tile->m_top_margin > 0);
+    assert(bottom_tile->m_height >= m_bottom_margin);
+
+    end_changed |= copy_border(bottom_border, *bottom_tile,
+                               bottom_tile->m_side_version,
+                               bottom_tile->m_top_margin, 0,
+                               m_top_margin + m_height, 0, m_bottom_margin,
+                               width_with_margin, stats);
   }
 
   // update left border
   if (left_tile) {
-    assert(left_tile->m_right_margin == 1);
-    assert(m_left_margin == 1);
-
-    gsl_vector_view neighbour = gsl_matrix_column(
-        left_tile->m_matrix, left_tile->m_width + left_tile->m_left_margin - 1);
-    gsl_vector_view border = gsl_matrix_column(m_matrix, 0);
+    assert(m_left_margin > 0 && left_tile->m_right_margin > 0);
+    assert(left_tile->m_width >= m_left_margin);
 
-    gsl_vector_memcpy(&border.vector, &neighbour.vector);
+    side_changed |= copy_border(
+        left_border, *left_tile, left_tile->m_end_version, 0,
+        left_tile->m_left_margin + left_tile->m_width - m_left_margin, 0, 0,
+        height_with_margin, m_left_margin, stats);
   }
 
   // update right border
   if (right_tile) {
-    assert(right_tile->m_left_margin == 1);
-    assert(m_right_margin == 1);
-
-    gsl_vector_view neighbour = gsl_matrix_column(right_tile->m_matrix, 1);
-    gsl_vector_view border =
-        gsl_matrix_column(m_matrix, m_width + m_left_margin);
-
-    gsl_vector_memcpy(&border.vector, &neighbour.vector);
+    assert(m_right_margin > 0 && right_tile->m_left_margin > 0);
+    assert(right_tile->m_width >= m_right_margin);
+
+    side_changed |= copy_border(right_border, *right_tile,
+                                right_tile->m_end_version, 0,
+                                right_tile->m_left_margin, 0,
+                                m_left_margin + m_width, height_with_margin,
+                                m_right_margin, stats);
   }
 
+  // Corners are read by no neighbour, so copying them changes no version.
+
   // update top-left border
   if (top_left_tile) {
-    assert(top_left_tile->m_bottom_margin == 1 &&
-           top_left_tile->m_right_margin == 1);
-    assert(m_top_margin == 1 && m_left_margin == 1);
-
-    gsl_matrix_set(
-        m_matrix, 0, 0,
-        gsl_matrix_get(
-            top_left_tile->m_matrix,
-            top_left_tile->m_height + top_left_tile->m_top_margin - 1,
-            top_left_tile->m_width + top_left_tile->m_left_margin - 1));
+    assert(m_top_margin > 0 && m_left_margin > 0);
+    assert(top_left_tile->m_height >= m_top_margin &&
+           top_left_tile->m_width >= m_left_margin);
+
+    copy_border(top_left_border, *top_left_tile, 0,
+                top_left_tile->m_top_margin + top_left_tile->m_height -
+                    m_top_margin,
+                top_left_tile->m_left_margin + top_left_tile->m_width -
+                    m_left_margin,
+                0, 0, m_top_margin, m_left_margin, stats);
   }
 
   // update top-right border
   if (top_right_tile) {
-    assert(top_right_tile->m_bottom_margin == 1 &&
-           top_right_tile->m_left_margin == 1);
-    assert(m_top_margin == 1 && m_right_margin == 1);
-
-    gsl_matrix_set(m_matrix, 0, m_width + m_left_margin,
-                   gsl_matrix_get(top_right_tile->m_matrix,
-                                  top_right_tile->m_height +
-                                      top_right_tile->m_top_margin - 1,
-                                  1));
+    assert(m_top_margin > 0 && m_right_margin > 0);
+    assert(top_right_tile->m_height >= m_top_margin &&
+           top_right_tile->m_width >= m_right_margin);
+
+    copy_border(top_right_border, *top_right_tile, 0,
+                top_right_tile->m_top_margin + top_right_tile->m_height -
+                    m_top_margin,
+                top_right_tile->m_left_margin, 0, m_left_margin + m_width,
+                m_top_margin, m_right_margin, stats);
   }
 
   // update bottom-left border
   if (bottom_left_tile) {
-    assert(bottom_left_tile->m_top_margin == 1 &&
-           bottom_left_tile->m_right_margin == 1);
-    assert(m_bottom_margin == 1 && m_left_margin == 1);
-
-    gsl_matrix_set(m_matrix, m_height + m_top_margin, 0,
-                   gsl_matrix_get(bottom_left_tile->m_matrix, 1,
-                                  bottom_left_tile->m_width +
-                                      bottom_left_tile->m_left_margin - 1));
+    assert(m_bottom_margin > 0 && m_left_margin > 0);
+    assert(bottom_left_tile->m_height >= m_bottom_margin &&
+           bottom_left_tile->m_width >= m_left_margin);
+
+    copy_border(bottom_left_border, *bottom_left_tile, 0,
+                bottom_left_tile->m_top_margin,
+                bottom_left_tile->m_left_margin + bottom_left_tile->m_width -
+                    m_left_margin,
+                m_top_margin + m_height, 0, m_bottom_margin, m_left_margin,
+                stats);
   }
 
   // update bottom-right border
   if (bottom_right_tile) {
-    assert(bottom_right_tile->m_top_margin == 1 &&
-           bottom_right_tile->m_left_margin == 1);
-    assert(m_bottom_margin == 1 && m_right_margin == 1);
+    assert(m_bottom_margin > 0 && m_right_margin > 0);
+    assert(bottom_right_tile->m_height >= m_bottom_margin &&
+           bottom_right_tile->m_width >= m_right_margin);
+
+    copy_border(bottom_right_border, *bottom_right_tile, 0,
+                bottom_right_tile->m_top_margin,
+                bottom_right_tile->m_left_margin, m_top_margin + m_height,
+                m_left_margin + m_width, m_bottom_margin, m_right_margin,
+                stats);
+  }
 
-    gsl_matrix_set(m_matrix, m_height + m_top_margin, m_width + m_left_margin,
-                   gsl_matrix_get(bottom_right_tile->m_matrix, 1, 1));
+  if (side_changed) {
+    m_side_version = next_version();
+  }
+  if (end_changed) {
+    m_end_version = next_version();
   }
+  stats.active_tiles = stats.copied_edges > 0 ? 1 : 0;
+  return stats;
 }
 
-} // namespace praster
\ No newline at end of file
+template class basic_tile<std::uint8_t>;
+template class basic_tile<std::int16_t>;
+template class basic_tile<std::uint16_t>;
+template class basic_tile<std::int32_t>;
+template class basic_tile<std::uint32_t>;
+template class basic_tile<float>;
+template class basic_tile<double>;
+
+} // namespace praster
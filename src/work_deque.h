@@ -0,0 +1,133 @@
+#ifndef PRASTER_WORK_DEQUE_H
+#define PRASTER_WORK_DEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace praster {
+
+// Lock-free work-stealing deque of pointers, after Chase and Lev as put
+// into the C11 memory model by Le et al. The owning thread pushes and pops
+// at the bottom, last in first out, so that the task it spawned last runs
+// while its data is still in cache; other threads steal from the top, first
+// in first out, taking the oldest and usually largest pieces of work. The
+// ring grows as needed; outgrown rings are kept until the deque goes away,
+// as a thief may still be reading one. Capacities are powers of two.
+template <typename T> class work_deque {
+public:
+  work_deque() : work_deque(256) {}
+
+  explicit work_deque(std::size_t capacity) {
+    m_rings.push_back(std::make_unique<ring>(capacity));
+    m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+  }
+
+  work_deque(const work_deque &) = delete;
+  work_deque &operator=(const work_deque &) = delete;
+
+  // Owner only.
+  void push(T *item) {
+    const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+    const std::int64_t t = m_top.load(std::memory_order_acquire);
+    ring *r = m_ring.load(std::memory_order_relaxed);
+
+    if (b - t > static_cast<std::int64_t>(r->mask)) {
+      r = grow(r, t, b);
+    }
+
+    r->put(b, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only; null if empty.
+  T *pop() {
+    const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    ring *r = m_ring.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = m_top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T *item = r->get(b);
+    if (t == b) {
+      // the last item, which a thief may be taking at the same time
+      if (!m_top.compare_exchange_strong(t, t + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Any thread; null if empty or if another thread took the item first.
+  T *steal() {
+    std::int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+      return nullptr;
+    }
+
+    T *item = m_ring.load(std::memory_order_acquire)->get(t);
+    if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  // Any thread; a hint only, as the deque may change meanwhile.
+  bool empty() const noexcept {
+    return m_top.load(std::memory_order_relaxed) >=
+           m_bottom.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct ring {
+    std::size_t mask;
+    std::unique_ptr<std::atomic<T *>[]> items;
+
+    explicit ring(std::size_t capacity)
+        : mask(capacity - 1),
+          items(std::make_unique<std::atomic<T *>[]>(capacity)) {}
+
+    T *get(std::int64_t i) const noexcept {
+      return items[i & mask].load(std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t i, T *item) noexcept {
+      items[i & mask].store(item, std::memory_order_relaxed);
+    }
+  };
+
+  // top and bottom on lines of their own, as thieves hammer the first and
+  // the owner the second
+  alignas(64) std::atomic<std::int64_t> m_top{0};
+  alignas(64) std::atomic<std::int64_t> m_bottom{0};
+  alignas(64) std::atomic<ring *> m_ring;
+  std::vector<std::unique_ptr<ring>> m_rings;
+
+  ring *grow(ring *r, std::int64_t t, std::int64_t b) {
+    m_rings.push_back(std::make_unique<ring>(2 * (r->mask + 1)));
+    ring *bigger = m_rings.back().get();
+    for (std::int64_t i = t; i < b; ++i) {
+      bigger->put(i, r->get(i));
+    }
+    m_ring.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+};
+
+} // namespace praster
+
+#endif
@@ -0,0 +1,156 @@
+#include <iostream>
+
+#include "allocator.h"
+#include "stripe.h"
+
+#include <cstdint>
+#include <vector>
+
+#define BOOST_TEST_MODULE test allocator
+#include <boost/test/included/unit_test.hpp>
+
+using namespace praster;
+
+namespace {
+
+bool is_aligned(const void *buffer) {
+  return reinterpret_cast<std::uintptr_t>(buffer) %
+             buffer_allocator::alignment ==
+         0;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(AllocatorSizeClasses) {
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(1), 64);
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(64), 64);
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(65), 80);
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(1024), 1024);
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(1025), 1280);
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(1700), 1792);
+  BOOST_CHECK_EQUAL(pool_allocator::size_class(1793), 2048);
+
+  for (std::size_t bytes = 1; bytes < 100000; bytes += 37) {
+    const std::size_t class_bytes = pool_allocator::size_class(bytes);
+    BOOST_CHECK(class_bytes >= bytes);
+    BOOST_CHECK(class_bytes <= bytes + bytes / 4 + 64);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AllocatorAligned) {
+  aligned_allocator allocator;
+
+  void *a = allocator.allocate(100);
+  void *b = allocator.allocate(1000);
+
+  BOOST_CHECK(is_aligned(a));
+  BOOST_CHECK(is_aligned(b));
+
+  allocator_stats stats = allocator.get_stats();
+  BOOST_CHECK_EQUAL(stats.current_bytes, 1100);
+  BOOST_CHECK_EQUAL(stats.peak_bytes, 1100);
+  BOOST_CHECK_EQUAL(stats.allocations, 2);
+
+  allocator.deallocate(a, 100);
+  allocator.deallocate(b, 1000);
+
+  stats = allocator.get_stats();
+  BOOST_CHECK_EQUAL(stats.current_bytes, 0);
+  BOOST_CHECK_EQUAL(stats.reserved_bytes, 0);
+  BOOST_CHECK_EQUAL(stats.peak_bytes, 1100);
+}
+
+BOOST_AUTO_TEST_CASE(AllocatorPoolReuse) {
+  pool_allocator allocator;
+
+  void *a = allocator.allocate(1000);
+  BOOST_CHECK(is_aligned(a));
+  allocator.deallocate(a, 1000);
+
+  BOOST_CHECK_EQUAL(allocator.get_pooled_bytes(), 1024);
+
+  // a request in the same size class gets the same buffer back
+  void *b = allocator.allocate(1010);
+  BOOST_CHECK_EQUAL(a, b);
+  BOOST_CHECK_EQUAL(allocator.get_pooled_bytes(), 0);
+
+  allocator_stats stats = allocator.get_stats();
+  BOOST_CHECK_EQUAL(stats.current_bytes, 1010);
+  BOOST_CHECK_EQUAL(stats.peak_bytes, 1010);
+  BOOST_CHECK_EQUAL(stats.reserved_bytes, 1024);
+  BOOST_CHECK_EQUAL(stats.allocations, 2);
+  BOOST_CHECK_EQUAL(stats.reuses, 1);
+
+  allocator.deallocate(b, 1010);
+  allocator.release();
+
+  stats = allocator.get_stats();
+  BOOST_CHECK_EQUAL(stats.current_bytes, 0);
+  BOOST_CHECK_EQUAL(stats.reserved_bytes, 0);
+  BOOST_CHECK_EQUAL(stats.peak_reserved_bytes, 1024);
+  BOOST_CHECK_EQUAL(allocator.get_pooled_bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(AllocatorPoolLimit) {
+  pool_allocator allocator(1024);
+
+  void *a = allocator.allocate(1024);
+  void *b = allocator.allocate(1024);
+  allocator.deallocate(a, 1024);
+  allocator.deallocate(b, 1024);
+
+  // only one of the buffers fits in the pool, the other one is freed
+  BOOST_CHECK_EQUAL(allocator.get_pooled_bytes(), 1024);
+  BOOST_CHECK_EQUAL(allocator.get_stats().reserved_bytes, 1024);
+}
+
+BOOST_AUTO_TEST_CASE(AllocatorStripeReuse) {
+  const int ds_width = 20;
+  const int ds_height = 16;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  pool_allocator allocator;
+  stripe_options options{.allocator = &allocator};
+
+  std::size_t first_reserved = 0;
+
+  // stripes of the same shape, built one after another, run on the buffers
+  // of the first one
+
+  for (int partition = 1; partition < 3; ++partition) {
+    stripe s = stripe::build(partition, partition * 4, 4, ds_width, ds_height,
+                             -1, 5, 4, reader_callback, options);
+
+    BOOST_CHECK(s.get_allocator() == &allocator);
+    for (const tile &t : s.get_tiles()) {
+      BOOST_CHECK(t.get_allocator() == &allocator);
+    }
+
+    BOOST_CHECK_EQUAL(s.get_tiles()[1].get_value(0, 0),
+                      partition * 4 * ds_width + 5);
+
+    if (partition == 1) {
+      first_reserved = allocator.get_stats().reserved_bytes;
+    }
+  }
+
+  allocator_stats stats = allocator.get_stats();
+  BOOST_CHECK_EQUAL(stats.current_bytes, 0);
+  BOOST_CHECK_EQUAL(stats.reserved_bytes, first_reserved);
+  BOOST_CHECK_EQUAL(stats.peak_reserved_bytes, first_reserved);
+  BOOST_CHECK_EQUAL(stats.reuses, 4);
+}
@@ -0,0 +1,549 @@
+#include <iostream>
+
+#include "algorithm.h"
+#include "executor.h"
+#include "numa.h"
+#include "task_future.h"
+#include "task_graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sched.h>
+
+#define BOOST_TEST_MODULE test executor
+#include <boost/test/included/unit_test.hpp>
+
+using namespace praster;
+
+BOOST_AUTO_TEST_CASE(NumaTopology) {
+  BOOST_CHECK(parse_cpu_list("0-3,8,10-11") ==
+              std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  BOOST_CHECK(parse_cpu_list("5,1-2,x,") == std::vector<int>({1, 2, 5}));
+  BOOST_CHECK(parse_cpu_list("").empty());
+
+  const std::filesystem::path root =
+      std::filesystem::temp_directory_path() / "praster_test_numa";
+  std::filesystem::remove_all(root);
+
+  // two nodes of processors and one of memory alone
+  std::filesystem::create_directories(root / "node0");
+  std::filesystem::create_directories(root / "node1");
+  std::filesystem::create_directories(root / "node2");
+  std::ofstream(root / "node0" / "cpulist") << "0-3,8-11\n";
+  std::ofstream(root / "node1" / "cpulist") << "4-7,12-15\n";
+  std::ofstream(root / "node2" / "cpulist") << "\n";
+  std::ofstream(root / "online") << "0-2\n";
+
+  const std::vector<numa_node> nodes = read_numa_topology(root.string());
+  BOOST_REQUIRE_EQUAL(nodes.size(), 2);
+  BOOST_CHECK_EQUAL(nodes[0].id, 0);
+  BOOST_CHECK_EQUAL(nodes[1].id, 1);
+  BOOST_CHECK(nodes[1].cpus ==
+              std::vector<int>({4, 5, 6, 7, 12, 13, 14, 15}));
+
+  std::filesystem::remove_all(root);
+
+  // without sysfs, a single node of the processors we may run on
+  const std::vector<numa_node> fallback = read_numa_topology(root.string());
+  BOOST_REQUIRE_EQUAL(fallback.size(), 1);
+  BOOST_CHECK(fallback[0].cpus == allowed_cpus());
+  BOOST_CHECK(!allowed_cpus().empty());
+
+  // stripes in contiguous blocks, the same node every time
+  BOOST_CHECK_EQUAL(numa_node_of(0, 6, 2), 0);
+  BOOST_CHECK_EQUAL(numa_node_of(2, 6, 2), 0);
+  BOOST_CHECK_EQUAL(numa_node_of(3, 6, 2), 1);
+  BOOST_CHECK_EQUAL(numa_node_of(5, 6, 2), 1);
+  BOOST_CHECK_EQUAL(numa_node_of(5, 6, 1), 0);
+
+  // two cores of two hyperthreads each, and a processor sysfs does not know
+  const std::filesystem::path cpu_root =
+      std::filesystem::temp_directory_path() / "praster_test_cpu";
+  std::filesystem::remove_all(cpu_root);
+  for (const auto &[cpu, siblings] :
+       {std::pair{0, "0,2"}, std::pair{1, "1,3"}, std::pair{2, "0,2"},
+        std::pair{3, "1,3"}}) {
+    const std::filesystem::path topology =
+        cpu_root / ("cpu" + std::to_string(cpu)) / "topology";
+    std::filesystem::create_directories(topology);
+    std::ofstream(topology / "thread_siblings_list") << siblings << "\n";
+  }
+
+  const std::vector<std::vector<int>> cores =
+      read_cpu_cores({0, 1, 2, 3, 4}, cpu_root.string());
+  BOOST_CHECK(cores ==
+              std::vector<std::vector<int>>({{0, 2}, {1, 3}, {4}}));
+  std::filesystem::remove_all(cpu_root);
+
+  // two nodes of two such cores each
+  const std::vector<std::vector<std::vector<int>>> machine = {
+      {{0, 4}, {1, 5}}, {{2, 6}, {3, 7}}};
+  BOOST_CHECK(compact_order(machine) ==
+              std::vector<int>({0, 4, 1, 5, 2, 6, 3, 7}));
+  BOOST_CHECK(scatter_order(machine) ==
+              std::vector<int>({0, 2, 1, 3, 4, 6, 5, 7}));
+}
+
+BOOST_AUTO_TEST_CASE(ExecutorNumaAware) {
+  for (int num_threads : {1, 4}) {
+    executor exec(num_threads, {.numa_aware = true});
+    BOOST_CHECK(exec.get_num_nodes() >= 1);
+    BOOST_CHECK(exec.get_num_nodes() <= num_threads);
+
+    // every task runs once, consecutive task numbers on the same or the
+    // next node
+
+    std::mutex mutex;
+    std::vector<int> nodes(num_threads, -1);
+    bool stable = true;
+    for (int pass = 0; pass < 3; ++pass) {
+      exec.broadcast(
+          [&](executor::context ctx) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stable = stable && (nodes[ctx.task_num] == -1 ||
+                                nodes[ctx.task_num] == ctx.executor_node);
+            nodes[ctx.task_num] = ctx.executor_node;
+          },
+          true);
+    }
+
+    BOOST_CHECK(stable);
+    BOOST_CHECK_EQUAL(nodes.front(), 0);
+    BOOST_CHECK_EQUAL(nodes.back(), exec.get_num_nodes() - 1);
+    BOOST_CHECK(std::is_sorted(nodes.begin(), nodes.end()));
+  }
+
+  // an executor unaware of nodes keeps them all as one
+  executor plain(2);
+  BOOST_CHECK_EQUAL(plain.get_num_nodes(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ExecutorPinning) {
+  const std::vector<int> allowed = allowed_cpus();
+  const std::vector<numa_node> topology = read_numa_topology();
+  const std::vector<std::vector<int>> cores = read_cpu_cores(allowed);
+
+  // the system node and the core of a processor, as the context reports them
+  auto node_of = [&topology](int cpu) {
+    for (const numa_node &node : topology) {
+      if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) {
+        return node.id;
+      }
+    }
+    return -1;
+  };
+  auto core_of = [&cores](int cpu) {
+    for (std::size_t i = 0; i < cores.size(); ++i) {
+      if (std::binary_search(cores[i].begin(), cores[i].end(), cpu)) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  };
+
+  // every thread pinned to an allowed processor, which its tasks see along
+  // with its core and node
+
+  for (placement pinning :
+       {placement::compact, placement::scatter, placement::listed}) {
+    for (bool numa_aware : {false, true}) {
+      executor exec(3, {.numa_aware = numa_aware,
+                        .pinning = pinning,
+                        .cpus = {allowed.back()}});
+
+      std::atomic<bool> pinned{true};
+      std::atomic<bool> running_there{true};
+      std::atomic<bool> located{true};
+      for (int pass = 0; pass < 3; ++pass) {
+        exec.broadcast(
+            [&](executor::context ctx) {
+              pinned = pinned && std::binary_search(allowed.begin(),
+                                                    allowed.end(), ctx.cpu);
+              running_there = running_there && sched_getcpu() == ctx.cpu;
+              located = located && ctx.numa_node == node_of(ctx.cpu) &&
+                        ctx.core == core_of(ctx.cpu) && ctx.core >= 0 &&
+                        ctx.numa_node >= 0;
+            },
+            true);
+      }
+      BOOST_CHECK(pinned);
+      BOOST_CHECK(running_there);
+      BOOST_CHECK(located);
+    }
+  }
+
+  // unpinned threads say so
+  executor plain(2);
+  std::atomic<int> cpu{0};
+  std::atomic<int> core{0};
+  plain.broadcast(
+      [&](executor::context ctx) {
+        cpu = ctx.cpu;
+        core = ctx.core;
+      },
+      true);
+  BOOST_CHECK_EQUAL(cpu.load(), -1);
+  BOOST_CHECK_EQUAL(core.load(), -1);
+
+  // listed processors have to be ones the process may run on
+  int outside = 0;
+  while (std::binary_search(allowed.begin(), allowed.end(), outside)) {
+    ++outside;
+  }
+  BOOST_CHECK_THROW(executor(2, {.pinning = placement::listed}),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(
+      executor(2, {.pinning = placement::listed, .cpus = {outside}}),
+      std::invalid_argument);
+}
+
+namespace {
+
+// Sums 1..n by splitting the range in halves, each half a task of its own,
+// the way a divide and conquer algorithm spawns subtasks.
+long long split_sum(executor &exec, long long first, long long last) {
+  if (last - first < 64) {
+    long long sum = 0;
+    for (long long i = first; i <= last; ++i) {
+      sum += i;
+    }
+    return sum;
+  }
+
+  const long long middle = (first + last) / 2;
+  long long left = 0;
+  long long right = 0;
+
+  task_group group(exec);
+  group.run([&](executor::context) {
+    left = split_sum(exec, first, middle);
+  });
+  group.run([&](executor::context) {
+    right = split_sum(exec, middle + 1, last);
+  });
+  group.wait();
+  return left + right;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ExecutorWorkStealing) {
+  executor exec(4);
+
+  // tasks submitted from outside, each run exactly once, numbered 0
+
+  {
+    std::atomic<int> runs{0};
+    std::atomic<int> numbered{0};
+    task_group group(exec);
+    for (int i = 0; i < 10000; ++i) {
+      group.run([&](executor::context ctx) {
+        ++runs;
+        numbered += ctx.task_num == 0 ? 1 : 0;
+      });
+    }
+    group.wait();
+    BOOST_CHECK_EQUAL(runs.load(), 10000);
+    BOOST_CHECK_EQUAL(numbered.load(), 10000);
+  }
+
+  // subtasks spawned from tasks, groups nested as deep as the recursion
+
+  {
+    long long sum = 0;
+    task_group group(exec);
+    group.run([&](executor::context) { sum = split_sum(exec, 1, 100000); });
+    group.wait();
+    BOOST_CHECK_EQUAL(sum, 100000LL * 100001 / 2);
+  }
+
+  // a blocked broadcast from inside a task runs all of its tasks
+
+  {
+    std::atomic<int> inner{0};
+    exec.broadcast(
+        [&](executor::context) {
+          exec.broadcast([&inner](executor::context) { ++inner; }, true);
+        },
+        true);
+    BOOST_CHECK_EQUAL(inner.load(), 16);
+  }
+
+  // broadcasts number their tasks from 0
+
+  {
+    std::mutex mutex;
+    std::vector<int> task_nums;
+    exec.broadcast(
+        [&](executor::context ctx) {
+          std::lock_guard<std::mutex> lock(mutex);
+          task_nums.push_back(ctx.task_num);
+        },
+        true);
+    std::sort(task_nums.begin(), task_nums.end());
+    BOOST_CHECK(task_nums == std::vector<int>({0, 1, 2, 3}));
+  }
+
+  // errors of the tasks of a group reach its wait
+
+  {
+    task_group group(exec);
+    for (int i = 0; i < 100; ++i) {
+      group.run([i](executor::context) {
+        if (i == 42) {
+          throw std::runtime_error("task failed");
+        }
+      });
+    }
+    BOOST_CHECK_THROW(group.wait(), std::runtime_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ExecutorDrainsOnDestruction) {
+  std::atomic<int> runs{0};
+  {
+    executor exec(2);
+    for (int i = 0; i < 1000; ++i) {
+      exec.submit([&](executor::context) {
+        ++runs;
+        exec.submit([&runs](executor::context) { ++runs; });
+      });
+    }
+  }
+  BOOST_CHECK_EQUAL(runs.load(), 2000);
+}
+
+BOOST_AUTO_TEST_CASE(TeamSupersteps) {
+  const int num_threads = 4;
+  const int steps = 500;
+  executor exec(num_threads);
+  team region(exec);
+  BOOST_CHECK_EQUAL(region.get_size(), num_threads);
+
+  // every superstep sees what all tasks wrote in the one before, and every
+  // task stays on its thread
+
+  std::vector<int> values(num_threads, -1);
+  std::vector<std::thread::id> threads(num_threads);
+  std::atomic<bool> consistent{true};
+  std::atomic<bool> stable{true};
+  region.run([&](executor::context ctx) {
+    threads[ctx.task_num] = std::this_thread::get_id();
+    for (int step = 0; step < steps; ++step) {
+      values[ctx.task_num] = step;
+      region.sync();
+      for (int v : values) {
+        consistent = consistent && v == step;
+      }
+      stable = stable && threads[ctx.task_num] == std::this_thread::get_id();
+      region.sync();
+    }
+  });
+  BOOST_CHECK(consistent);
+  BOOST_CHECK(stable);
+
+  // a failing body releases the others from their barriers
+  std::atomic<int> left{0};
+  auto failing = [&](executor::context ctx) {
+    for (int step = 0; step < steps; ++step) {
+      if (ctx.task_num == 1 && step == 10) {
+        throw std::runtime_error("task failed");
+      }
+      region.sync();
+    }
+    ++left;
+  };
+  BOOST_CHECK_THROW(region.run(failing), std::runtime_error);
+  BOOST_CHECK_EQUAL(left.load(), 0);
+
+  // the team runs again afterwards
+  std::atomic<int> runs{0};
+  region.run([&](executor::context) {
+    region.sync();
+    ++runs;
+  });
+  BOOST_CHECK_EQUAL(runs.load(), num_threads);
+
+  // a team needs all threads, which a task of the executor holds one of
+  task_group group(exec);
+  group.run([&](executor::context) {
+    region.run([](executor::context) {});
+  });
+  BOOST_CHECK_THROW(group.wait(), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(TaskFutures) {
+  executor exec(3);
+
+  // results waited for one at a time, from outside the pool
+  std::vector<task_future<int>> squares;
+  for (int i = 0; i < 100; ++i) {
+    squares.push_back(async(exec, [i](executor::context) { return i * i; }));
+  }
+  BOOST_CHECK_EQUAL(squares[7].get(), 49);
+  BOOST_CHECK_EQUAL(squares[7].get(), 49);
+
+  // continuations chained on results, void ones included
+  std::atomic<int> seen{0};
+  task_future<void> chain =
+      squares[9]
+          .then([](const int &v) { return v + 1; })
+          .then([&seen](const int &v) { seen = v; })
+          .then([&seen]() { ++seen; });
+  chain.wait();
+  BOOST_CHECK(chain.is_ready());
+  BOOST_CHECK_EQUAL(seen.load(), 83);
+
+  // stateful and move-only callables, called as non-const
+  auto owned = std::make_unique<int>(20);
+  task_future<int> counted =
+      async(exec, [calls = 0](executor::context) mutable { return ++calls; });
+  task_future<int> moved =
+      counted.then([p = std::move(owned)](const int &v) mutable {
+        *p += v;
+        return *p;
+      });
+  BOOST_CHECK_EQUAL(moved.get(), 21);
+
+  // joining many tile tasks keeps their order
+  const std::vector<int> all = when_all(exec, squares).get();
+  BOOST_REQUIRE_EQUAL(all.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    BOOST_CHECK_EQUAL(all[i], i * i);
+  }
+  BOOST_CHECK(when_all(exec, std::vector<task_future<int>>()).get().empty());
+
+  // futures waited for from a task help run the tasks they wait on
+  task_future<long long> nested = async(exec, [&exec](executor::context) {
+    std::vector<task_future<void>> parts;
+    std::atomic<long long> sum{0};
+    for (int i = 1; i <= 1000; ++i) {
+      parts.push_back(async(exec, [&sum, i](executor::context) { sum += i; }));
+    }
+    when_all(exec, parts).wait();
+    return sum.load();
+  });
+  BOOST_CHECK_EQUAL(nested.get(), 500500);
+
+  // exceptions reach get, skipping the continuations after them
+  std::atomic<bool> skipped{true};
+  task_future<int> failing = async(exec, [](executor::context) -> int {
+    throw std::runtime_error("task failed");
+  });
+  task_future<void> after =
+      failing.then([&skipped](const int &) { skipped = false; });
+  BOOST_CHECK_THROW(failing.get(), std::runtime_error);
+  BOOST_CHECK_THROW(after.get(), std::runtime_error);
+  BOOST_CHECK(skipped);
+
+  std::vector<task_future<int>> some = {squares[1], failing};
+  BOOST_CHECK_THROW(when_all(exec, some).get(), std::runtime_error);
+
+  BOOST_CHECK(!task_future<int>().valid());
+  BOOST_CHECK_THROW(task_future<int>().wait(), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(TaskGraph) {
+  executor exec(3);
+
+  // a diamond a -> (b, c) -> d, each task checking that those before it
+  // are done
+
+  std::vector<std::atomic<int>> done(4);
+  std::atomic<bool> ordered{true};
+  task_graph graph;
+  const std::size_t a = graph.add([&](executor::context) { ++done[0]; });
+  const std::size_t b = graph.add([&](executor::context) {
+    ordered = ordered && done[0] == 1;
+    ++done[1];
+  });
+  const std::size_t c = graph.add([&](executor::context) {
+    ordered = ordered && done[0] == 1;
+    ++done[2];
+  });
+  const std::size_t d = graph.add([&](executor::context) {
+    ordered = ordered && done[1] == 1 && done[2] == 1;
+    ++done[3];
+  });
+  graph.precede(a, b);
+  graph.precede(a, c);
+  graph.precede(b, d);
+  graph.precede(c, d);
+
+  graph.run(exec);
+  BOOST_CHECK(ordered);
+  for (std::atomic<int> &count : done) {
+    BOOST_CHECK_EQUAL(count.load(), 1);
+  }
+
+  // graphs run again as they are
+  graph.run(exec);
+  BOOST_CHECK_EQUAL(done[3].load(), 2);
+
+  // a failing task skips those after it
+  task_graph failing;
+  std::atomic<int> after{0};
+  const std::size_t first = failing.add(
+      [](executor::context) { throw std::runtime_error("task failed"); });
+  const std::size_t second =
+      failing.add([&after](executor::context) { ++after; });
+  failing.precede(first, second);
+  BOOST_CHECK_THROW(failing.run(exec), std::runtime_error);
+  BOOST_CHECK_EQUAL(after.load(), 0);
+
+  // cycles are reported rather than waited on forever
+  task_graph cycle;
+  const std::size_t x = cycle.add([](executor::context) {});
+  const std::size_t y = cycle.add([](executor::context) {});
+  cycle.precede(x, y);
+  cycle.precede(y, x);
+  BOOST_CHECK_THROW(cycle.run(exec), std::logic_error);
+  BOOST_CHECK_THROW(cycle.precede(x, 5), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(ScanGridWavefront) {
+  executor exec(4);
+  const int rows = 7;
+  const int columns = 9;
+
+  for (ScanDirection direction :
+       {ScanDirection::LeftToRight, ScanDirection::RightToLeft,
+        ScanDirection::TopToBottom, ScanDirection::BottomToTop,
+        ScanDirection::TopLeftToBottomRight,
+        ScanDirection::TopRightToBottomLeft,
+        ScanDirection::BottomLeftToTopRight,
+        ScanDirection::BottomRightToTopLeft}) {
+    const scan_step step = get_scan_step(direction);
+
+    // every cell runs once, after the cells before it in the scan
+    std::vector<std::atomic<int>> done(rows * columns);
+    std::atomic<bool> ordered{true};
+    scan_grid(exec, rows, columns, direction, [&](int y_id, int x_id) {
+      for (int dy : {0, step.dy}) {
+        for (int dx : {0, step.dx}) {
+          const int y = y_id - dy;
+          const int x = x_id - dx;
+          if ((dy != 0 || dx != 0) && y >= 0 && y < rows && x >= 0 &&
+              x < columns) {
+            ordered = ordered && done[y * columns + x] == 1;
+          }
+        }
+      }
+      ++done[y_id * columns + x_id];
+    });
+
+    BOOST_CHECK(ordered);
+    BOOST_CHECK(std::all_of(done.begin(), done.end(),
+                            [](const std::atomic<int> &n) { return n == 1; }));
+  }
+}
@@ -0,0 +1,350 @@
+#include <iostream>
+
+#include "local.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#define BOOST_TEST_MODULE test local
+#include <boost/test/included/unit_test.hpp>
+
+using namespace praster;
+
+namespace {
+
+std::vector<local::isa> available_isas() {
+  std::vector<local::isa> result;
+  for (local::isa target :
+       {local::isa::scalar, local::isa::avx2, local::isa::avx512}) {
+    if (target <= local::supported_isa()) {
+      result.push_back(target);
+    }
+  }
+  return result;
+}
+
+// Builds a tile with one cell of margin on each side, an interior wide enough
+// to exercise both the vector body and the scalar tail of the kernels, and
+// every seventh cell set to nodata.
+template <typename T> basic_tile<T> create_tile(T nodata, int offset) {
+  const int width = 67;
+  const int height = 5;
+
+  basic_tile<T> t(0, 0, width, height, 1, 1, 1, 1, nodata,
+                  [](int, int, int width, int height, T *buffer) {
+                    std::fill(buffer, buffer + width * height, T(42));
+                  });
+  t.transform([nodata, offset](int y, int x, T) {
+    const int c = y * 67 + x;
+    return c % 7 == 0 ? nodata : static_cast<T>((c + offset) % 100);
+  });
+  return t;
+}
+
+template <typename T, typename F>
+std::vector<T> expected_values(const basic_tile<T> &t, F &&op) {
+  std::vector<T> expected = t.to_vector(false);
+  for (T &value : expected) {
+    value = op(value);
+  }
+  return expected;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(LocalScalarArithmetic) {
+  for (local::isa target : available_isas()) {
+    local::set_isa(target);
+    BOOST_TEST_CONTEXT("isa " << local::isa_name(target)) {
+      {
+        auto t = create_tile<std::uint8_t>(255, 3);
+        auto expected = expected_values(t, [](std::uint8_t v) {
+          return v == 255 ? v : static_cast<std::uint8_t>(v + 7);
+        });
+        local::add<std::uint8_t>(t, 7);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<std::int16_t>(-9999, 1);
+        auto expected = expected_values(t, [](std::int16_t v) {
+          return v == -9999 ? v : static_cast<std::int16_t>(v * 3);
+        });
+        local::multiply<std::int16_t>(t, 3);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<float>(-1.0f, 0);
+        auto expected = expected_values(
+            t, [](float v) { return v == -1.0f ? v : v - 0.5f; });
+        local::subtract(t, 0.5f);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<double>(-1.0, 0);
+        auto expected = expected_values(
+            t, [](double v) { return v == -1.0 ? v : v / 4.0; });
+        local::divide(t, 4.0);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<std::int32_t>(-1, 0);
+        local::divide(t, 0);
+        t.foreach ([](std::int32_t v) { BOOST_CHECK_EQUAL(v, -1); });
+      }
+
+      // the lowest int32 as nodata is divided by -1 along with every other
+      // cell and must not trap; a valid lowest value wraps to itself
+      {
+        constexpr std::int32_t lowest =
+            std::numeric_limits<std::int32_t>::min();
+        auto t = create_tile<std::int32_t>(lowest, 0);
+        auto expected = expected_values(
+            t, [](std::int32_t v) { return v == lowest ? v : -v; });
+        local::divide(t, -1);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+
+        auto u = create_tile<std::int32_t>(-1, 0);
+        u.set_value(2, 0, lowest);
+        local::divide(u, -1);
+        BOOST_CHECK_EQUAL(u.get_value(2, 0), lowest);
+
+        // sums and products wrap around rather than overflow
+        u.set_value(2, 0, std::numeric_limits<std::int32_t>::max());
+        local::add(u, 1);
+        BOOST_CHECK_EQUAL(u.get_value(2, 0), lowest);
+
+        auto w = create_tile<std::int32_t>(lowest, 0);
+        expected = expected_values(w, [](std::int32_t v) {
+          return v == lowest ? v
+                             : static_cast<std::int32_t>(
+                                   static_cast<std::uint32_t>(v) << 30);
+        });
+        local::multiply(w, 1 << 30);
+        actual = w.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+    }
+  }
+  local::set_isa(local::supported_isa());
+}
+
+BOOST_AUTO_TEST_CASE(LocalTileArithmetic) {
+  for (local::isa target : available_isas()) {
+    local::set_isa(target);
+    BOOST_TEST_CONTEXT("isa " << local::isa_name(target)) {
+      auto t = create_tile<std::int16_t>(-1, 0);
+      auto other = create_tile<std::int16_t>(-2, 5);
+      other.set_value(0, 3, 0);
+
+      auto a = t.to_vector(false);
+      auto b = other.to_vector(false);
+
+      std::vector<std::int16_t> expected(a.size());
+      for (std::size_t i = 0; i < a.size(); ++i) {
+        expected[i] = (a[i] == -1 || b[i] == -2 || b[i] == 0)
+                          ? -1
+                          : static_cast<std::int16_t>(a[i] / b[i]);
+      }
+
+      local::divide(t, other);
+      auto actual = t.to_vector(false);
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                    expected.begin(), expected.end());
+
+      auto d = create_tile<double>(-1.0, 0);
+      auto e = create_tile<double>(-1.0, 2);
+      auto da = d.to_vector(false);
+      auto eb = e.to_vector(false);
+      std::vector<double> sums(da.size());
+      for (std::size_t i = 0; i < da.size(); ++i) {
+        sums[i] = (da[i] == -1.0 || eb[i] == -1.0) ? -1.0 : da[i] + eb[i];
+      }
+
+      local::add(d, e);
+      auto actual_sums = d.to_vector(false);
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual_sums.begin(), actual_sums.end(),
+                                    sums.begin(), sums.end());
+
+      // int32 with the lowest value as nodata, divided by -1 cell by cell
+      constexpr std::int32_t lowest = std::numeric_limits<std::int32_t>::min();
+      auto n = create_tile<std::int32_t>(lowest, 0);
+      auto minus_one = create_tile<std::int32_t>(0, 0);
+      minus_one.transform([](std::int32_t) { return std::int32_t{-1}; });
+      n.set_value(1, 0, 0);
+      auto na = n.to_vector(false);
+      std::vector<std::int32_t> quotients(na.size());
+      for (std::size_t i = 0; i < na.size(); ++i) {
+        quotients[i] = na[i] == lowest ? lowest : -na[i];
+      }
+
+      local::divide(n, minus_one);
+      auto actual_quotients = n.to_vector(false);
+      BOOST_CHECK_EQUAL_COLLECTIONS(
+          actual_quotients.begin(), actual_quotients.end(), quotients.begin(),
+          quotients.end());
+
+      // a valid lowest value over -1 wraps to itself, as negation would
+      auto m = create_tile<std::int32_t>(0, 0);
+      m.set_value(3, 0, lowest);
+      auto m_other = create_tile<std::int32_t>(1, 0);
+      m_other.transform([](std::int32_t) { return std::int32_t{-1}; });
+      local::divide(m, m_other);
+      BOOST_CHECK_EQUAL(m.get_value(3, 0), lowest);
+    }
+  }
+  local::set_isa(local::supported_isa());
+
+  auto t = create_tile<double>(-1.0, 0);
+  basic_tile<double> other(0, 0, 3, 3, 0, 0, 0, 0, -1.0);
+  BOOST_CHECK_THROW(local::add(t, other), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(LocalClassification) {
+  for (local::isa target : available_isas()) {
+    local::set_isa(target);
+    BOOST_TEST_CONTEXT("isa " << local::isa_name(target)) {
+      {
+        auto t = create_tile<std::uint8_t>(255, 0);
+        auto expected = expected_values(t, [](std::uint8_t v) -> std::uint8_t {
+          return v == 255 ? v : (v < 20 ? 20 : (v > 80 ? 80 : v));
+        });
+        local::clamp<std::uint8_t>(t, 20, 80);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<float>(-1.0f, 0);
+        auto expected = expected_values(t, [](float v) {
+          return v == -1.0f ? v : (v < 50.0f ? 0.0f : 1.0f);
+        });
+        local::threshold(t, 50.0f, 0.0f, 1.0f);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<std::int32_t>(-1, 0);
+        auto expected = expected_values(t, [](std::int32_t v) {
+          if (v == -1) {
+            return v;
+          }
+          if (v >= 0 && v < 30) {
+            return 1;
+          }
+          if (v >= 20 && v < 60) {
+            return 2;
+          }
+          return v;
+        });
+        local::reclassify<std::int32_t>(t, {{0, 30, 1}, {20, 60, 2}});
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      expected.begin(), expected.end());
+      }
+
+      {
+        auto t = create_tile<double>(-1.0, 1);
+        auto m = create_tile<double>(-5.0, 0);
+        auto values = t.to_vector(false);
+        auto masks = m.to_vector(false);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+          values[i] = masks[i] == -5.0 ? -1.0 : values[i];
+        }
+        local::mask(t, m);
+        auto actual = t.to_vector(false);
+        BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                      values.begin(), values.end());
+      }
+    }
+  }
+  local::set_isa(local::supported_isa());
+}
+
+BOOST_AUTO_TEST_CASE(LocalMarginsUntouched) {
+  auto t = create_tile<double>(-1.0, 0);
+
+  local::add(t, 1.0);
+
+  auto after = t.to_vector(true);
+  const int width_with_margin = t.get_width() + 2;
+  for (int x = 0; x < width_with_margin; ++x) {
+    BOOST_CHECK_EQUAL(after[x], 42);
+  }
+  BOOST_CHECK_EQUAL(after[width_with_margin], 42);
+
+  // nor does an empty operand, which only clears the interior
+  auto other = create_tile<double>(-1.0, 0);
+  other.fill(-1.0);
+  other.compact();
+  BOOST_REQUIRE(other.get_state() == tile_state::empty);
+
+  local::add(t, other);
+
+  after = t.to_vector(true);
+  for (int x = 0; x < width_with_margin; ++x) {
+    BOOST_CHECK_EQUAL(after[x], 42);
+  }
+  BOOST_CHECK_EQUAL(after[width_with_margin], 42);
+  BOOST_CHECK_EQUAL(t.count_valid(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LocalCompactTiles) {
+  auto constant_tile = [](double value) {
+    return tile(0, 0, 67, 5, 1, 1, 1, 1, -1.0,
+                [value](int, int, int width, int height, double *buffer) {
+                  std::fill(buffer, buffer + width * height, value);
+                });
+  };
+
+  // operations preserve nodata, so empty tiles are skipped
+  auto empty = constant_tile(-1.0);
+  local::add(empty, 1.0);
+  local::threshold(empty, 0.0, 1.0, 2.0);
+  local::add(empty, create_tile<double>(-1.0, 0));
+  BOOST_CHECK(empty.get_state() == tile_state::empty);
+
+  // uniform tiles stay compact where the operation keeps their value
+  auto uniform = constant_tile(5.0);
+  local::clamp(uniform, 0.0, 10.0);
+  local::multiply(uniform, constant_tile(1.0));
+  local::mask(uniform, constant_tile(3.0));
+  BOOST_CHECK(uniform.get_state() == tile_state::uniform);
+  BOOST_CHECK_EQUAL(uniform.get_value(0, 0), 5.0);
+
+  local::add(uniform, 1.0);
+  BOOST_CHECK(uniform.get_state() == tile_state::mixed);
+  BOOST_CHECK_EQUAL(uniform.get_value(4, 66), 6.0);
+
+  // an empty operand turns the interior to nodata, compacting the tile if
+  // its margins hold nodata too
+  auto t = create_tile<double>(-1.0, 0);
+  local::mask(t, constant_tile(-1.0));
+  BOOST_CHECK(t.get_state() == tile_state::mixed);
+  BOOST_CHECK_EQUAL(t.count_valid(), 0);
+
+  auto padded = constant_tile(-1.0);
+  padded.set_value(2, 3, 4.0);
+  local::mask(padded, constant_tile(-1.0));
+  BOOST_CHECK(padded.get_state() == tile_state::empty);
+  BOOST_CHECK_EQUAL(padded.get_value(2, 3), -1.0);
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+
+#include "executor.h"
+#include "parallel.h"
+#include "stripe.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE test parallel
+#include <boost/test/included/unit_test.hpp>
+
+using namespace praster;
+
+namespace {
+
+const parallel_options all_schedules[] = {
+    {.kind = schedule::fixed},  {.kind = schedule::fixed, .chunk = 7},
+    {.kind = schedule::dynamic}, {.kind = schedule::dynamic, .chunk = 1},
+    {.kind = schedule::guided},  {.kind = schedule::guided, .chunk = 5}};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ParallelFor) {
+  executor exec(3);
+
+  for (const parallel_options &options : all_schedules) {
+    for (std::size_t count : {0, 1, 2, 100, 1001}) {
+      // every index exactly once
+      std::vector<std::atomic<int>> visits(count + 10);
+      parallel_for(
+          exec, 10, 10 + count, [&visits](std::size_t i) { ++visits[i]; },
+          options);
+
+      for (std::size_t i = 0; i < visits.size(); ++i) {
+        BOOST_CHECK_EQUAL(visits[i].load(), i < 10 ? 0 : 1);
+      }
+
+      const long long sum = parallel_reduce(
+          exec, 0, count, 0LL,
+          [](std::size_t i) { return static_cast<long long>(i); },
+          [](long long a, long long b) { return a + b; }, options);
+      BOOST_CHECK_EQUAL(sum, static_cast<long long>(count) *
+                                 (static_cast<long long>(count) - 1) / 2);
+    }
+  }
+
+  // combine need not commute: the partials of the chunks, whichever thread
+  // took them, are joined in index order; a pause now and then lets the
+  // other threads take the chunks in between
+  std::string expected;
+  for (std::size_t i = 0; i < 500; ++i) {
+    expected += std::to_string(i) + ",";
+  }
+  for (const parallel_options &options : all_schedules) {
+    const std::string joined = parallel_reduce(
+        exec, 0, 500, std::string(),
+        [](std::size_t i) {
+          if (i % 50 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+          return std::to_string(i) + ",";
+        },
+        [](std::string a, const std::string &b) { return a + b; }, options);
+    BOOST_CHECK_EQUAL(joined, expected);
+  }
+
+  // the first error stops the loop and reaches the caller
+  for (const parallel_options &options : all_schedules) {
+    BOOST_CHECK_THROW(parallel_for(
+                          exec, 0, 1000,
+                          [](std::size_t i) {
+                            if (i == 500) {
+                              throw std::runtime_error("index failed");
+                            }
+                          },
+                          options),
+                      std::runtime_error);
+  }
+
+  // loops nest, the inner one run by the threads of the outer
+  std::atomic<int> inner{0};
+  parallel_for(exec, 0, 10, [&](std::size_t) {
+    parallel_for(exec, 0, 10, [&inner](std::size_t) { ++inner; });
+  });
+  BOOST_CHECK_EQUAL(inner.load(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(ParallelOverTiles) {
+  const int ds_width = 40;
+  const int ds_height = 24;
+
+  auto reader_callback = [](int x, int, int width, int height,
+                            float *buffer) {
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[i * width + j] = (x + j) % 5 == 0 ? -1.0f : 1.0f;
+      }
+    }
+  };
+
+  basic_stripe<float> s = basic_stripe<float>::build(
+      0, 0, ds_height, ds_width, ds_height, -1.0f, 6, 4, reader_callback);
+
+  executor exec(4);
+
+  // a local operation on every tile, then the count of the data cells
+  parallel_for_each(exec, s.get_tiles(), [](basic_tile<float> &t) {
+    t.transform([](float v) { return v == -1.0f ? v : v * 2; });
+  });
+
+  const tile_statistics<float> stats = parallel_reduce(
+      exec, 0, s.get_tiles().size(), tile_statistics<float>{},
+      [&s](std::size_t i) { return s.get_tiles()[i].get_statistics(); },
+      [](tile_statistics<float> a, const tile_statistics<float> &b) {
+        a.merge(b);
+        return a;
+      },
+      {.kind = schedule::guided});
+
+  BOOST_CHECK_EQUAL(stats.count, ds_width * ds_height * 4 / 5);
+  BOOST_CHECK_EQUAL(stats.nodata_count, ds_width * ds_height / 5);
+  BOOST_CHECK_EQUAL(stats.sum, 2.0 * stats.count);
+  BOOST_CHECK_EQUAL(stats.max, 2.0f);
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+
+#include "allocator.h"
+#include "executor.h"
+#include "pipeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#define BOOST_TEST_MODULE test pipeline
+#include <boost/test/included/unit_test.hpp>
+
+using namespace praster;
+
+BOOST_AUTO_TEST_CASE(PipelineRollingStripes) {
+  const int ds_width = 13;
+  const int ds_height = 40;
+  const double nodata = -1;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = (i * 7) % 23;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  std::vector<double> output(ds_width * ds_height, 0);
+  auto writer_callback = [&output](int x, int y, int width, int height,
+                                   const double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        output[(y + i) * ds_width + x + j] = buffer[index++];
+      }
+    }
+  };
+
+  // the prepare stage shifts every value, and the compute stage takes the
+  // 3x3 maximum, which needs the shifted values of the neighbour stripes
+
+  auto prepare = [](stripe &s) {
+    for (tile &t : s.get_tiles()) {
+      t.transform([](double v) { return v + 100; });
+    }
+  };
+
+  std::size_t stripe_bytes = 0;
+  auto compute = [&stripe_bytes](stripe &s) {
+    stripe_bytes = std::max(stripe_bytes, s.get_memory_bytes());
+    s.stencil<1>([](const window<double, 1> &w) {
+      double result = w.center();
+      for (double neighbour : w.neighbours()) {
+        result = std::max(result, neighbour);
+      }
+      return result;
+    });
+  };
+
+  std::vector<double> expected(dataset.size());
+  for (int y = 0; y < ds_height; ++y) {
+    for (int x = 0; x < ds_width; ++x) {
+      double result = nodata;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          if (y + dy >= 0 && y + dy < ds_height && x + dx >= 0 &&
+              x + dx < ds_width) {
+            result = std::max(result,
+                              dataset[(y + dy) * ds_width + x + dx] + 100);
+          }
+        }
+      }
+      expected[y * ds_width + x] = result;
+    }
+  }
+
+  pool_allocator allocator;
+  std::vector<stripe_extent> extents;
+  for (int y = 0; y < ds_height; y += 4) {
+    extents.push_back({y, 4});
+  }
+  pipeline p(ds_width, ds_height, nodata, 4, 3, extents, reader_callback,
+             writer_callback,
+             {.pad_edges = true, .allocator = &allocator,
+              .double_buffered = true});
+
+  // one stripe after another on this thread
+
+  const pipeline_stats serial = p.run(prepare, compute);
+  BOOST_CHECK_EQUAL(serial.stripes, 10);
+  BOOST_CHECK(serial.peak_resident_stripes <= 3);
+  BOOST_CHECK(serial.exchanges.copied_edges > 0);
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                expected.begin(), expected.end());
+
+  // loads and writes on the executor, overlapping the computation
+
+  std::fill(output.begin(), output.end(), 0);
+  executor io(2);
+  const pipeline_stats overlapped = p.run(prepare, compute, io);
+  BOOST_CHECK(overlapped.peak_resident_stripes <= 4);
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                expected.begin(), expected.end());
+
+  // the released stripes hand their buffers to the ones loaded later, the
+  // memory held staying that of a few stripes, size classes rounding up
+  BOOST_CHECK(allocator.get_stats().reuses > 0);
+  BOOST_CHECK(allocator.get_stats().peak_bytes <= 5 * stripe_bytes);
+
+  // errors of any stage reach the caller once the pending work is done
+
+  int computed = 0;
+  auto failing_compute = [&computed](stripe &) {
+    if (++computed == 3) {
+      throw std::runtime_error("compute failed");
+    }
+  };
+  BOOST_CHECK_THROW(p.run(nullptr, failing_compute, io), std::runtime_error);
+
+  // stripes have to cover the dataset
+
+  BOOST_CHECK_THROW(pipeline(ds_width, ds_height, nodata, 4, 3,
+                             {{0, 8}, {10, 30}}, reader_callback,
+                             writer_callback),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(pipeline(ds_width, ds_height, nodata, 4, 3, {{0, 8}},
+                             reader_callback, writer_callback),
+                    std::invalid_argument);
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+
+#include "planner.h"
+#include "stripe.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE test planner
+#include <boost/test/included/unit_test.hpp>
+
+using namespace praster;
+
+namespace {
+
+void write_cache(const std::filesystem::path &path, const std::string &level,
+                 const std::string &type, const std::string &size) {
+  std::filesystem::create_directories(path);
+  std::ofstream(path / "level") << level << '\n';
+  std::ofstream(path / "type") << type << '\n';
+  std::ofstream(path / "size") << size << '\n';
+  std::ofstream(path / "coherency_line_size") << "128\n";
+}
+
+// Builds every stripe of the plan, which throws if the plan breaks any of
+// the rules of basic_stripe::build.
+void check_buildable(const partition_plan &plan, int ds_width, int ds_height,
+                     int halo) {
+  auto reader_callback = [](int, int, int width, int height, float *buffer) {
+    std::fill(buffer, buffer + width * height, 1.0f);
+  };
+
+  BOOST_REQUIRE(!plan.stripes.empty());
+  BOOST_CHECK_EQUAL(plan.stripes.front().y, 0);
+
+  std::size_t tiles = 0;
+  int y = 0;
+  for (std::size_t i = 0; i < plan.stripes.size(); ++i) {
+    const stripe_extent &extent = plan.stripes[i];
+    BOOST_CHECK_EQUAL(extent.y, y);
+    y += extent.height;
+
+    auto s = basic_stripe<float>::build(
+        i, extent.y, extent.height, ds_width, ds_height, -1.0f,
+        plan.tile_width, plan.tile_height, reader_callback, {.halo = halo});
+    tiles += s.get_tiles().size();
+  }
+  BOOST_CHECK_EQUAL(y, ds_height);
+  BOOST_CHECK_EQUAL(tiles, plan.tile_count);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(PlannerCacheTopology) {
+  const std::filesystem::path root =
+      std::filesystem::temp_directory_path() / "praster_test_planner";
+  std::filesystem::remove_all(root);
+
+  write_cache(root / "index0", "1", "Data", "48K");
+  write_cache(root / "index1", "1", "Instruction", "32K");
+  write_cache(root / "index2", "2", "Unified", "2048K");
+  write_cache(root / "index3", "3", "Unified", "30M");
+
+  const cache_topology caches = read_cache_topology(root.string());
+  BOOST_CHECK(caches.detected);
+  BOOST_CHECK_EQUAL(caches.l1_bytes, 48 * 1024);
+  BOOST_CHECK_EQUAL(caches.l2_bytes, 2048 * 1024);
+  BOOST_CHECK_EQUAL(caches.l3_bytes, 30 * 1024 * 1024);
+  BOOST_CHECK_EQUAL(caches.line_bytes, 128);
+
+  std::filesystem::remove_all(root);
+
+  // without sysfs the defaults are kept
+  const cache_topology defaults = read_cache_topology(root.string());
+  BOOST_CHECK(!defaults.detected);
+  BOOST_CHECK_EQUAL(defaults.l2_bytes, cache_topology{}.l2_bytes);
+}
+
+BOOST_AUTO_TEST_CASE(PlannerPartition) {
+  const cache_topology caches = {.line_bytes = 64,
+                                 .l1_bytes = 48 * 1024,
+                                 .l2_bytes = 1024 * 1024,
+                                 .l3_bytes = 32 * 1024 * 1024,
+                                 .detected = true};
+
+  // a large raster: tiles fill half of L2, rows in whole cache lines
+  {
+    const partition_plan plan =
+        plan_partition(20000, 10000, sizeof(float), 1, 8, caches);
+    BOOST_CHECK(plan.tile_bytes <= caches.l2_bytes / 2);
+    BOOST_CHECK(plan.tile_bytes > caches.l2_bytes / 4);
+    BOOST_CHECK_EQUAL(plan.tile_width % (64 / sizeof(float)), 0);
+    BOOST_CHECK(plan.tile_count >= 4 * 8);
+    BOOST_CHECK(!plan.explanation.empty());
+    check_buildable(plan, 20000, 10000, 1);
+  }
+
+  // a small one: tiles shrink to give every thread four of them
+  {
+    const partition_plan plan =
+        plan_partition(500, 300, sizeof(float), 2, 16, caches);
+    BOOST_CHECK(plan.tile_count >= 4 * 16);
+    check_buildable(plan, 500, 300, 2);
+  }
+
+  // awkward sizes, where the last tiles must still cover the halo
+  for (int halo : {0, 1, 3, 7}) {
+    for (int threads : {1, 3, 64}) {
+      const partition_plan plan =
+          plan_partition(1001, 777, sizeof(float), halo, threads, caches);
+      check_buildable(plan, 1001, 777, halo);
+    }
+  }
+
+  // a narrow raster gets taller tiles
+  {
+    const partition_plan plan =
+        plan_partition(40, 100000, sizeof(float), 1, 2, caches);
+    BOOST_CHECK_EQUAL(plan.tile_width, 40);
+    BOOST_CHECK(plan.tile_height > 1000);
+    check_buildable(plan, 40, 100000, 1);
+  }
+
+  BOOST_CHECK_THROW(plan_partition(0, 10, sizeof(float), 1, 1, caches),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(plan_partition(3, 3, sizeof(float), 5, 1, caches),
+                    std::invalid_argument);
+}
@@ -1,8 +1,12 @@
 #include <iostream>
 
+#include "executor.h"
+#include "numa.h"
 #include "stripe.h"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #define BOOST_TEST_MODULE test stripe
@@ -219,4 +223,931 @@ BOOST_AUTO_TEST_CASE(StripeTileLoad) {
       BOOST_REQUIRE_EQUAL(tile.get_nodata(), -1);
     }
   }
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(StripeTypedLoadWrite) {
+  const int ds_width = 10;
+  const int ds_height = 9;
+
+  std::vector<std::uint8_t> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = static_cast<std::uint8_t>(i);
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    std::uint8_t *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  std::vector<std::uint8_t> output(ds_width * ds_height, 0);
+
+  auto writer_callback = [&output](int x, int y, int width, int height,
+                                   const std::uint8_t *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        output[(y + i) * ds_width + x + j] = buffer[index++];
+      }
+    }
+  };
+
+  auto top = basic_stripe<std::uint8_t>::build(0, 0, 5, ds_width, ds_height,
+                                                255, 3, 4, reader_callback);
+  auto bottom = basic_stripe<std::uint8_t>::build(
+      1, 5, 4, ds_width, ds_height, 255, 3, 4, reader_callback);
+
+  BOOST_REQUIRE_EQUAL(top.get_nodata(), 255);
+  BOOST_REQUIRE_EQUAL(top.get_tiles()[0].get_nodata(), 255);
+  BOOST_REQUIRE_EQUAL(top.get_tiles()[5].get_value(0, 1), 44);
+
+  top.write(writer_callback);
+  bottom.write(writer_callback);
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(), dataset.begin(),
+                                dataset.end());
+}
+
+BOOST_AUTO_TEST_CASE(StripeHaloExchange) {
+  const int ds_width = 12;
+  const int ds_height = 10;
+  const int halo = 2;
+
+  std::vector<int> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    std::int32_t *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  std::vector<basic_stripe<std::int32_t>> stripes;
+  stripes.push_back(basic_stripe<std::int32_t>::build(
+      0, 0, 6, ds_width, ds_height, -1, 4, 3, reader_callback, {.halo = halo}));
+  stripes.push_back(basic_stripe<std::int32_t>::build(
+      1, 6, 4, ds_width, ds_height, -1, 4, 2, reader_callback, {.halo = halo}));
+
+  {
+    auto &tile = stripes[0].get_tiles()[4];
+
+    BOOST_REQUIRE_EQUAL(stripes[0].get_halo(), halo);
+    BOOST_REQUIRE_EQUAL(stripes[0].get_bottom_margin(), halo);
+    BOOST_REQUIRE_EQUAL(tile.get_x(), 4);
+    BOOST_REQUIRE_EQUAL(tile.get_y(), 3);
+    BOOST_REQUIRE_EQUAL(tile.get_left_margin(), halo);
+    BOOST_REQUIRE_EQUAL(tile.get_right_margin(), halo);
+    BOOST_REQUIRE_EQUAL(tile.get_top_margin(), halo);
+    BOOST_REQUIRE_EQUAL(tile.get_bottom_margin(), halo);
+  }
+
+  for (auto &stripe : stripes) {
+    for (auto &tile : stripe.get_tiles()) {
+      tile.transform([](std::int32_t val) { return val + 1000; });
+    }
+  }
+
+  stripes[0].update_borders(nullptr, &stripes[1]);
+  stripes[1].update_borders(&stripes[0], nullptr);
+
+  // every cell of every buffer, margins included, holds the updated value
+
+  for (auto &stripe : stripes) {
+    for (auto &tile : stripe.get_tiles()) {
+      const int width = tile.get_width() + tile.get_left_margin() +
+                        tile.get_right_margin();
+      const int x0 = tile.get_x() - tile.get_left_margin();
+      const int y0 = tile.get_y() - tile.get_top_margin();
+
+      auto actual = tile.to_vector(true);
+      std::vector<std::int32_t> expected(actual.size());
+      for (std::size_t i = 0; i < actual.size(); ++i) {
+        const int y = y0 + static_cast<int>(i) / width;
+        const int x = x0 + static_cast<int>(i) % width;
+        expected[i] = dataset[y * ds_width + x] + 1000;
+      }
+
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                    expected.begin(), expected.end());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeParallelHaloExchange) {
+  const int ds_width = 24;
+  const int ds_height = 18;
+  const std::int32_t nodata = -1;
+
+  // the two left tile columns hold nothing but nodata
+
+  std::vector<std::int32_t> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i % ds_width < 8 ? nodata : i;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    std::int32_t *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  auto build = [&]() {
+    std::vector<basic_stripe<std::int32_t>> stripes;
+    for (int i = 0; i < 3; ++i) {
+      stripes.push_back(basic_stripe<std::int32_t>::build(
+          i, i * 6, 6, ds_width, ds_height, nodata, 4, 3, reader_callback,
+          {.halo = 2, .pad_edges = true}));
+    }
+    for (auto &stripe : stripes) {
+      for (auto &tile : stripe.get_tiles()) {
+        tile.transform(
+            [nodata](std::int32_t v) { return v == nodata ? v : v + 1000; });
+      }
+    }
+    return stripes;
+  };
+
+  std::vector<basic_stripe<std::int32_t>> serial = build();
+  for (std::size_t i = 0; i < serial.size(); ++i) {
+    serial[i].update_borders(i > 0 ? &serial[i - 1] : nullptr,
+                             i + 1 < serial.size() ? &serial[i + 1] : nullptr);
+  }
+
+  executor exec(3);
+  std::vector<basic_stripe<std::int32_t>> parallel = build();
+  basic_stripe<std::int32_t>::update_borders(parallel, exec);
+
+  for (std::size_t s = 0; s < serial.size(); ++s) {
+    const auto &tiles = parallel[s].get_tiles();
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+      auto expected = serial[s].get_tiles()[i].to_vector(true);
+      auto actual = tiles[i].to_vector(true);
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                    expected.begin(), expected.end());
+    }
+
+    // tiles surrounded by nodata stay compact, those next to data do not
+
+    BOOST_CHECK(tiles[0].get_state() == tile_state::empty);
+    BOOST_CHECK(tiles[1].get_state() == tile_state::mixed);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeDirtyBorders) {
+  const int ds_width = 24;
+  const int ds_height = 18;
+
+  std::vector<std::int32_t> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    std::int32_t *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  auto check_margins = [&dataset](const basic_stripe<std::int32_t> &stripe) {
+    for (const auto &tile : stripe.get_tiles()) {
+      const int width = tile.get_width() + tile.get_left_margin() +
+                        tile.get_right_margin();
+      const int x0 = tile.get_x() - tile.get_left_margin();
+      const int y0 = tile.get_y() - tile.get_top_margin();
+
+      auto actual = tile.to_vector(true);
+      std::vector<std::int32_t> expected(actual.size());
+      for (std::size_t i = 0; i < actual.size(); ++i) {
+        const int y = y0 + static_cast<int>(i) / width;
+        const int x = x0 + static_cast<int>(i) % width;
+        expected[i] = dataset[y * ds_width + x];
+      }
+
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                    expected.begin(), expected.end());
+    }
+  };
+
+  executor exec(2);
+
+  for (bool parallel : {false, true}) {
+    std::vector<basic_stripe<std::int32_t>> stripes;
+    for (int i = 0; i < 3; ++i) {
+      stripes.push_back(basic_stripe<std::int32_t>::build(
+          i, i * 6, 6, ds_width, ds_height, -1, 4, 3, reader_callback));
+    }
+
+    auto exchange = [&]() {
+      if (parallel) {
+        return basic_stripe<std::int32_t>::update_borders(stripes, exec);
+      }
+      exchange_stats stats;
+      for (std::size_t i = 0; i < stripes.size(); ++i) {
+        stats.merge(stripes[i].update_borders(
+            i > 0 ? &stripes[i - 1] : nullptr,
+            i + 1 < stripes.size() ? &stripes[i + 1] : nullptr));
+      }
+      return stats;
+    };
+
+    // exchanges settle once every border holds its neighbour's cells
+
+    auto settle = [&]() {
+      std::vector<exchange_stats> rounds;
+      do {
+        rounds.push_back(exchange());
+      } while (rounds.back().copied_edges > 0 && rounds.size() < 5);
+      BOOST_CHECK_EQUAL(rounds.back().copied_edges, 0);
+      BOOST_CHECK_EQUAL(rounds.back().active_tiles, 0);
+      return rounds;
+    };
+
+    auto first = settle();
+    BOOST_CHECK_EQUAL(first[0].tiles, 36);
+    BOOST_CHECK_EQUAL(first[0].copied_edges, first[0].edges);
+    BOOST_CHECK_EQUAL(first[0].active_tiles, first[0].tiles);
+
+    // a single tile changes, in the middle of the middle stripe
+
+    auto &tile = stripes[1].get_tiles()[8];
+    BOOST_REQUIRE_EQUAL(tile.get_x(), 8);
+    BOOST_REQUIRE_EQUAL(tile.get_y(), 9);
+    tile.transform([](int, int, std::int32_t v) { return v + 1000; });
+    for (int y = 9; y < 12; ++y) {
+      for (int x = 8; x < 12; ++x) {
+        dataset[y * ds_width + x] += 1000;
+      }
+    }
+
+    auto second = settle();
+    BOOST_CHECK(second[0].copied_edges >= (parallel ? 4 : 8));
+    BOOST_CHECK(second[0].copied_edges < second[0].edges / 4);
+    BOOST_CHECK(second[0].active_tiles < second[0].tiles / 2);
+
+    for (const auto &stripe : stripes) {
+      check_margins(stripe);
+    }
+
+    // writes through a view kept across an exchange go unnoticed until the
+    // view is fetched again
+
+    auto view = tile.get_view();
+    settle();
+    view(0, 0) += 1000;
+    dataset[9 * ds_width + 8] += 1000;
+    BOOST_CHECK_EQUAL(exchange().copied_edges, 0);
+
+    view = tile.get_view();
+    BOOST_CHECK(exchange().copied_edges > 0);
+    for (const auto &stripe : stripes) {
+      check_margins(stripe);
+    }
+    dataset[9 * ds_width + 8] -= 1000;
+
+    for (int y = 9; y < 12; ++y) {
+      for (int x = 8; x < 12; ++x) {
+        dataset[y * ds_width + x] -= 1000;
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeParallelLoad) {
+  const int ds_width = 40;
+  const int ds_height = 24;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i % 11 == 0 ? -1 : i;
+  }
+
+  // only reads shared state, so it can be called from several threads
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  executor exec(3);
+
+  for (const stripe_options &options :
+       {stripe_options{}, stripe_options{.pad_edges = true},
+        stripe_options{.double_buffered = true, .memory_budget = 4000}}) {
+    stripe serial = stripe::build(1, 8, 8, ds_width, ds_height, -1, 6, 4,
+                                  reader_callback, options);
+    stripe parallel = stripe::build(1, 8, 8, ds_width, ds_height, -1, 6, 4,
+                                    reader_callback, exec, options);
+
+    BOOST_REQUIRE_EQUAL(parallel.get_tiles().size(),
+                        serial.get_tiles().size());
+    if (options.memory_budget != 0) {
+      BOOST_CHECK(parallel.get_memory_bytes() <= options.memory_budget);
+    }
+
+    for (std::size_t i = 0; i < serial.get_tiles().size(); ++i) {
+      const tile &expected = serial.get_tile(i);
+      BOOST_CHECK_EQUAL(parallel.get_tiles()[i].get_x(), expected.get_x());
+      BOOST_CHECK_EQUAL(parallel.get_tiles()[i].get_y(), expected.get_y());
+
+      auto expected_cells = expected.to_vector(true);
+      auto actual_cells = parallel.get_tile(i).to_vector(true);
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual_cells.begin(), actual_cells.end(),
+                                    expected_cells.begin(),
+                                    expected_cells.end());
+    }
+  }
+
+  // errors of the callback reach the caller
+
+  auto failing_callback = [&](int x, int y, int width, int height,
+                              double *buffer) {
+    if (x > 20) {
+      throw std::runtime_error("read failed");
+    }
+    reader_callback(x, y, width, height, buffer);
+  };
+
+  BOOST_CHECK_THROW(stripe::build(0, 0, 8, ds_width, ds_height, -1, 6, 4,
+                                  failing_callback, exec),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(StripeCoalescedRead) {
+  const int ds_width = 40;
+  const int ds_height = 24;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i % 13 == 0 ? -1 : i;
+  }
+
+  int calls = 0;
+  auto reader_callback = [&](int x, int y, int width, int height,
+                             double *buffer) {
+    ++calls;
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  executor exec(2);
+
+  for (bool pad_edges : {false, true}) {
+    for (int y : {0, 8, 16}) {
+      calls = 0;
+      stripe expected = stripe::build(y / 8, y, 8, ds_width, ds_height, -1, 6,
+                                      4, reader_callback,
+                                      {.halo = 2, .pad_edges = pad_edges});
+      BOOST_CHECK_EQUAL(calls, expected.get_tiles().size());
+
+      calls = 0;
+      stripe_options options = {
+          .halo = 2, .pad_edges = pad_edges, .coalesced_read = true};
+      stripe coalesced = stripe::build(y / 8, y, 8, ds_width, ds_height, -1,
+                                       6, 4, reader_callback, options);
+      BOOST_CHECK_EQUAL(calls, 1);
+
+      calls = 0;
+      stripe parallel = stripe::build(y / 8, y, 8, ds_width, ds_height, -1, 6,
+                                      4, reader_callback, exec, options);
+      BOOST_CHECK_EQUAL(calls, 1);
+
+      for (std::size_t i = 0; i < expected.get_tiles().size(); ++i) {
+        auto expected_cells = expected.get_tiles()[i].to_vector(true);
+        for (const stripe *s : {&coalesced, &parallel}) {
+          auto actual_cells = s->get_tiles()[i].to_vector(true);
+          BOOST_CHECK_EQUAL_COLLECTIONS(
+              actual_cells.begin(), actual_cells.end(),
+              expected_cells.begin(), expected_cells.end());
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeHaloValidation) {
+  auto reader_callback = [](int, int, int width, int height,
+                            double *buffer) {
+    std::fill(buffer, buffer + width * height, 0.0);
+  };
+
+  // the last tile of each row would be a single column wide
+  BOOST_CHECK_THROW(
+      stripe::build(0, 0, 6, 10, 10, -1, 3, 3, reader_callback, {.halo = 2}),
+      std::invalid_argument);
+
+  // the stripe above would be a single row high
+  BOOST_CHECK_THROW(
+      stripe::build(1, 1, 6, 10, 10, -1, 5, 3, reader_callback, {.halo = 2}),
+      std::invalid_argument);
+
+  BOOST_CHECK_NO_THROW(
+      stripe::build(0, 0, 6, 10, 10, -1, 5, 3, reader_callback, {.halo = 2}));
+}
+
+BOOST_AUTO_TEST_CASE(StripePaddedEdgesStencil) {
+  const int ds_width = 11;
+  const int ds_height = 8;
+  const int halo = 2;
+  const double nodata = -1;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i % 13;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    BOOST_REQUIRE(x >= 0 && y >= 0 && x + width <= ds_width &&
+                  y + height <= ds_height);
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  const stripe_options options = {.halo = halo, .pad_edges = true};
+
+  std::vector<stripe> stripes;
+  stripes.push_back(stripe::build(0, 0, 4, ds_width, ds_height, nodata, 4, 2,
+                                  reader_callback, options));
+  stripes.push_back(stripe::build(1, 4, 4, ds_width, ds_height, nodata, 4, 4,
+                                  reader_callback, options));
+
+  stripes[0].update_borders(nullptr, &stripes[1]);
+  stripes[1].update_borders(&stripes[0], nullptr);
+
+  // every cell within radius 2 of a dataset cell is either that cell's value
+  // or nodata outside of the dataset
+
+  auto value_at = [&dataset, nodata](int y, int x) {
+    if (y < 0 || x < 0 || y >= ds_height || x >= ds_width) {
+      return nodata;
+    }
+    return dataset[y * ds_width + x];
+  };
+
+  for (auto &stripe : stripes) {
+    BOOST_REQUIRE(stripe.has_padded_edges());
+
+    for (auto &t : stripe.get_tiles()) {
+      BOOST_REQUIRE_EQUAL(t.get_left_margin(), halo);
+      BOOST_REQUIRE_EQUAL(t.get_right_margin(), halo);
+      BOOST_REQUIRE_EQUAL(t.get_top_margin(), halo);
+      BOOST_REQUIRE_EQUAL(t.get_bottom_margin(), halo);
+
+      tile result = tile(t.get_x(), t.get_y(), t.get_width(), t.get_height(),
+                         0, 0, 0, 0, nodata);
+
+      t.stencil<2>(result, [nodata](const window<double, 2> &w) {
+        double sum = 0;
+        for (int dy = -2; dy <= 2; ++dy) {
+          for (int dx = -2; dx <= 2; ++dx) {
+            sum += w(dy, dx) == nodata ? 0 : w(dy, dx);
+          }
+        }
+        return sum;
+      });
+
+      result.foreach ([&](int y, int x) {
+        const int ds_y = t.get_y() + y;
+        const int ds_x = t.get_x() + x;
+        double sum = 0;
+        for (int dy = -2; dy <= 2; ++dy) {
+          for (int dx = -2; dx <= 2; ++dx) {
+            double value = value_at(ds_y + dy, ds_x + dx);
+            sum += value == nodata ? 0 : value;
+          }
+        }
+        BOOST_CHECK_EQUAL(result.get_value(y, x), sum);
+      });
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeDoubleBufferedStencil) {
+  const int ds_width = 11;
+  const int ds_height = 8;
+  const int iterations = 3;
+  const double nodata = -1;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = (i * 7) % 23;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  // 3x3 maximum; nodata is below every value and so never wins
+  auto kernel = [](const window<double, 1> &w) {
+    double result = w.center();
+    for (double neighbour : w.neighbours()) {
+      result = std::max(result, neighbour);
+    }
+    return result;
+  };
+
+  std::vector<double> expected = dataset;
+  for (int i = 0; i < iterations; ++i) {
+    std::vector<double> next(expected.size());
+    for (int y = 0; y < ds_height; ++y) {
+      for (int x = 0; x < ds_width; ++x) {
+        double result = expected[y * ds_width + x];
+        for (int dy = -1; dy <= 1; ++dy) {
+          for (int dx = -1; dx <= 1; ++dx) {
+            if (y + dy >= 0 && y + dy < ds_height && x + dx >= 0 &&
+                x + dx < ds_width) {
+              result =
+                  std::max(result, expected[(y + dy) * ds_width + x + dx]);
+            }
+          }
+        }
+        next[y * ds_width + x] = result;
+      }
+    }
+    expected = next;
+  }
+
+  pool_allocator allocator;
+  const stripe_options options = {.pad_edges = true,
+                                  .allocator = &allocator,
+                                  .double_buffered = true};
+
+  std::vector<stripe> stripes;
+  stripes.push_back(stripe::build(0, 0, 4, ds_width, ds_height, nodata, 4, 2,
+                                  reader_callback, options));
+  stripes.push_back(stripe::build(1, 4, 4, ds_width, ds_height, nodata, 4, 4,
+                                  reader_callback, options));
+
+  BOOST_REQUIRE(stripes[0].is_double_buffered());
+
+  const std::size_t allocations = allocator.get_stats().allocations;
+
+  for (int i = 0; i < iterations; ++i) {
+    stripes[0].update_borders(nullptr, &stripes[1]);
+    stripes[1].update_borders(&stripes[0], nullptr);
+
+    for (auto &stripe : stripes) {
+      stripe.stencil<1>(kernel);
+    }
+  }
+
+  // the passes run on the buffers allocated up front
+  BOOST_CHECK_EQUAL(allocator.get_stats().allocations, allocations);
+
+  std::vector<double> output(ds_width * ds_height, 0);
+  auto writer_callback = [&output](int x, int y, int width, int height,
+                                   const double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        output[(y + i) * ds_width + x + j] = buffer[index++];
+      }
+    }
+  };
+
+  for (auto &stripe : stripes) {
+    stripe.write(writer_callback);
+  }
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                expected.begin(), expected.end());
+
+  // without a back buffer there is nothing to write into
+  stripe single = stripe::build(0, 0, 4, ds_width, ds_height, nodata, 4, 2,
+                                reader_callback, {.pad_edges = true});
+  BOOST_CHECK_THROW(single.stencil<1>(kernel), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(StripeMemoryBudget) {
+  const int ds_width = 64;
+  const int ds_height = 24;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = (i % ds_width) / 4 + (i / ds_width) / 4;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  auto kernel = [](const window<double, 1> &w) {
+    double result = w.center();
+    for (double neighbour : w.neighbours()) {
+      result = std::max(result, neighbour);
+    }
+    return result;
+  };
+
+  auto run = [&](std::size_t budget) {
+    stripe_options options = {.pad_edges = true,
+                              .double_buffered = true,
+                              .memory_budget = budget};
+    std::vector<stripe> stripes;
+    stripes.push_back(stripe::build(0, 0, 12, ds_width, ds_height, -1, 16, 6,
+                                    reader_callback, options));
+    stripes.push_back(stripe::build(1, 12, 12, ds_width, ds_height, -1, 16, 6,
+                                    reader_callback, options));
+
+    for (int i = 0; i < 2; ++i) {
+      stripes[0].update_borders(nullptr, &stripes[1]);
+      stripes[1].update_borders(&stripes[0], nullptr);
+      for (auto &stripe : stripes) {
+        stripe.stencil<1>(kernel);
+      }
+    }
+    return stripes;
+  };
+
+  std::vector<stripe> unlimited = run(0);
+
+  // a double-buffered tile takes 2 x 8 rows of 24 cells, padding included,
+  // so this fits a couple of them
+  const std::size_t budget = 6000;
+  std::vector<stripe> limited = run(budget);
+
+  for (int s = 0; s < 2; ++s) {
+    BOOST_CHECK(limited[s].get_memory_bytes() <= budget);
+    BOOST_CHECK(limited[s].get_memory_bytes() <
+                unlimited[s].get_memory_bytes() / 2);
+
+    const auto &tiles = limited[s].get_tiles();
+    BOOST_CHECK(std::count_if(tiles.begin(), tiles.end(), [](const tile &t) {
+                  return t.is_compressed();
+                }) > 0);
+
+    // margins are stale after the last pass, only interiors are compared
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+      auto expected = unlimited[s].get_tiles()[i].to_vector(false);
+      auto actual = limited[s].get_tile(i).to_vector(false);
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                    expected.begin(), expected.end());
+      BOOST_CHECK(limited[s].get_memory_bytes() <= budget);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeStatistics) {
+  const int ds_width = 50;
+  const int ds_height = 20;
+  const double nodata = -1;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i % 7 == 0 ? nodata : i % 50;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  tile_statistics<double> expected;
+  for (double v : dataset) {
+    if (v == nodata) {
+      ++expected.nodata_count;
+    } else {
+      ++expected.count;
+      expected.min = std::min(expected.min, v);
+      expected.max = std::max(expected.max, v);
+      expected.sum += v;
+    }
+  }
+
+  stripe s = stripe::build(0, 0, ds_height, ds_width, ds_height, nodata, 16,
+                           8, reader_callback);
+
+  executor exec(3);
+  for (const tile_statistics<double> &actual :
+       {s.get_statistics(), s.get_statistics(exec)}) {
+    BOOST_CHECK_EQUAL(actual.count, expected.count);
+    BOOST_CHECK_EQUAL(actual.nodata_count, expected.nodata_count);
+    BOOST_CHECK_EQUAL(actual.min, expected.min);
+    BOOST_CHECK_EQUAL(actual.max, expected.max);
+    BOOST_CHECK_EQUAL(actual.sum, expected.sum);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeNumaPlacement) {
+  const int ds_width = 24;
+  const int ds_height = 18;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = i % 7 == 0 ? -1 : i;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  // on a machine of a single node every stripe lands on node 0, and the
+  // results are those of an executor unaware of nodes
+
+  executor exec(3, {.numa_aware = true});
+  BOOST_CHECK(exec.get_num_nodes() >= 1);
+
+  std::vector<stripe> serial;
+  std::vector<stripe> placed;
+  for (int i = 0; i < 3; ++i) {
+    const int node = numa_node_of(i, 3, exec.get_num_nodes());
+    serial.push_back(stripe::build(i, i * 6, 6, ds_width, ds_height, -1, 4, 3,
+                                   reader_callback));
+    placed.push_back(stripe::build(i, i * 6, 6, ds_width, ds_height, -1, 4, 3,
+                                   reader_callback, exec,
+                                   {.numa_node = node}));
+    BOOST_CHECK_EQUAL(placed.back().get_numa_node(), node);
+  }
+
+  for (std::size_t i = 0; i < serial.size(); ++i) {
+    serial[i].update_borders(i > 0 ? &serial[i - 1] : nullptr,
+                             i + 1 < serial.size() ? &serial[i + 1] : nullptr);
+  }
+  stripe::update_borders(placed, exec);
+
+  for (std::size_t s = 0; s < serial.size(); ++s) {
+    const auto &tiles = placed[s].get_tiles();
+    BOOST_REQUIRE_EQUAL(tiles.size(), serial[s].get_tiles().size());
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+      auto expected = serial[s].get_tiles()[i].to_vector(true);
+      auto actual = tiles[i].to_vector(true);
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                    expected.begin(), expected.end());
+    }
+
+    const tile_statistics<double> expected = serial[s].get_statistics();
+    const tile_statistics<double> actual = placed[s].get_statistics(exec);
+    BOOST_CHECK_EQUAL(actual.count, expected.count);
+    BOOST_CHECK_EQUAL(actual.sum, expected.sum);
+  }
+
+  // nodes beyond those of the executor wrap around
+
+  stripe unplaced = stripe::build(0, 0, 6, ds_width, ds_height, -1, 4, 3,
+                                  reader_callback);
+  stripe wrapped = stripe::build(0, 0, 6, ds_width, ds_height, -1, 4, 3,
+                                 reader_callback, exec,
+                                 {.numa_node = exec.get_num_nodes()});
+  for (std::size_t i = 0; i < unplaced.get_tiles().size(); ++i) {
+    auto expected = unplaced.get_tiles()[i].to_vector(true);
+    auto actual = wrapped.get_tiles()[i].to_vector(true);
+    BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                  expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StripeWavefrontScan) {
+  const int ds_width = 24;
+  const int ds_height = 18;
+
+  std::vector<double> dataset(ds_width * ds_height);
+  for (int i = 0; i < ds_width * ds_height; ++i) {
+    dataset[i] = 1 + i % 3;
+  }
+
+  auto reader_callback = [&dataset](int x, int y, int width, int height,
+                                    double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[index++] = dataset[(y + i) * ds_width + x + j];
+      }
+    }
+  };
+
+  auto build = [&]() {
+    std::vector<stripe> stripes;
+    for (int i = 0; i < 3; ++i) {
+      stripes.push_back(stripe::build(i, i * 6, 6, ds_width, ds_height, 0, 5,
+                                      4, reader_callback,
+                                      {.pad_edges = true}));
+    }
+    return stripes;
+  };
+
+  std::vector<double> output(ds_width * ds_height);
+  auto writer_callback = [&output](int x, int y, int width, int height,
+                                   const double *buffer) {
+    int index = 0;
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        output[(y + i) * ds_width + x + j] = buffer[index++];
+      }
+    }
+  };
+
+  executor exec(3);
+
+  // Sums of all cells above and to the left, inclusive, which every tile
+  // computes from the sums its upstream neighbours left in its margins,
+  // the dataset edges padded with zeros.
+
+  std::vector<double> expected = dataset;
+  for (int y = 0; y < ds_height; ++y) {
+    for (int x = 0; x < ds_width; ++x) {
+      const double up = y > 0 ? expected[(y - 1) * ds_width + x] : 0;
+      const double left = x > 0 ? expected[y * ds_width + x - 1] : 0;
+      const double corner =
+          y > 0 && x > 0 ? expected[(y - 1) * ds_width + x - 1] : 0;
+      expected[y * ds_width + x] += up + left - corner;
+    }
+  }
+
+  std::vector<stripe> stripes = build();
+  stripe::scan(stripes, exec, ScanDirection::TopLeftToBottomRight,
+               [](tile &t) {
+                 auto v = t.get_view(true);
+                 const int top = t.get_top_margin();
+                 const int left = t.get_left_margin();
+                 for (int y = top; y < top + t.get_height(); ++y) {
+                   for (int x = left; x < left + t.get_width(); ++x) {
+                     v(y, x) += v(y - 1, x) + v(y, x - 1) - v(y - 1, x - 1);
+                   }
+                 }
+               });
+
+  for (const stripe &s : stripes) {
+    s.write(writer_callback);
+  }
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                expected.begin(), expected.end());
+
+  // running sums along each row, from the right, the rows side by side
+
+  expected = dataset;
+  for (int y = 0; y < ds_height; ++y) {
+    for (int x = ds_width - 2; x >= 0; --x) {
+      expected[y * ds_width + x] += expected[y * ds_width + x + 1];
+    }
+  }
+
+  stripes = build();
+  stripe::scan(stripes, exec, ScanDirection::RightToLeft, [](tile &t) {
+    auto v = t.get_view(true);
+    const int top = t.get_top_margin();
+    const int left = t.get_left_margin();
+    for (int y = top; y < top + t.get_height(); ++y) {
+      for (int x = left + t.get_width() - 1; x >= left; --x) {
+        v(y, x) += v(y, x + 1);
+      }
+    }
+  });
+
+  for (const stripe &s : stripes) {
+    s.write(writer_callback);
+  }
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                expected.begin(), expected.end());
+}
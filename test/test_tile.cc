@@ -2,7 +2,13 @@
 
 #include "tile.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #define BOOST_TEST_MODULE test tile
@@ -613,4 +619,611 @@ BOOST_AUTO_TEST_CASE(TileUpdateBorder) {
 
     gsl_matrix_free(matrix);
   }
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(TileKernels) {
+  const int ds_width = 9;
+  const int ds_height = 9;
+
+  gsl_matrix *matrix = create_test_matrix(ds_height, ds_width);
+  auto reader_callback = construct_reader_callback(matrix);
+
+  tile t_lambda = tile(3, 3, 3, 3, 1, 1, 1, 1, -1.0, reader_callback);
+  tile t_function = tile(3, 3, 3, 3, 1, 1, 1, 1, -1.0, reader_callback);
+
+  // lambdas bind to the templated kernels
+  t_lambda.transform([](double val) { return val * 2; });
+  t_lambda.transform([](int y, int x, double val) { return val + y * 10 + x; });
+
+  // std::function objects go through the type-erased wrappers
+  std::function<double(double)> scale = [](double val) { return val * 2; };
+  std::function<double(const std::pair<int, int> &, double)> offset =
+      [](const std::pair<int, int> &index, double val) {
+        return val + tile::destruct_index_y(index) * 10 +
+               tile::destruct_index_x(index);
+      };
+  t_function.transform(scale);
+  t_function.transform(offset);
+
+  auto expected = std::vector<double>{8, 9, 10, 18, 19, 20, 28, 29, 30};
+
+  std::vector<double> actual_lambda;
+  t_lambda.foreach ([&actual_lambda](double val) {
+    actual_lambda.push_back(val);
+  });
+
+  std::vector<double> actual_function;
+  std::function<void(double)> collect = [&actual_function](double val) {
+    actual_function.push_back(val);
+  };
+  t_function.foreach (collect);
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual_lambda.begin(), actual_lambda.end(),
+                                expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual_function.begin(),
+                                actual_function.end(), expected.begin(),
+                                expected.end());
+
+  // margins are left untouched
+  auto with_border = t_lambda.to_vector(true);
+  BOOST_REQUIRE_EQUAL(with_border.size(), 25);
+  BOOST_CHECK_EQUAL(with_border[0], 0);
+  BOOST_CHECK_EQUAL(with_border[24], 8);
+
+  gsl_matrix_free(matrix);
+}
+
+BOOST_AUTO_TEST_CASE(TileStencil) {
+  const int ds_width = 10;
+  const int ds_height = 9;
+
+  gsl_matrix *matrix = gsl_matrix_alloc(ds_height, ds_width);
+
+  int c = 0;
+  for (int i = 0; i < ds_height; ++i) {
+    for (int j = 0; j < ds_width; ++j) {
+      gsl_matrix_set(matrix, i, j, c++);
+    }
+  }
+
+  auto reader_callback = construct_reader_callback(matrix);
+
+  // tile in the top-left corner of the dataset, padded with nodata
+
+  tile t = tile(0, 0, 4, 3, 1, 1, 1, 1, -1.0);
+  t.fill(-1.0);
+  t.read(reader_callback, 0, 0, 5, 4);
+
+  BOOST_CHECK_EQUAL(t.get_value(0, 0), 0);
+  BOOST_CHECK_EQUAL(t.get_value(2, 3), 23);
+
+  auto expected_neighbours = std::array<double, 8>{-1, -1, -1, 1,
+                                                   11, 10, -1, -1};
+  auto actual_neighbours = t.get_neighbours(0, 0);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual_neighbours.begin(),
+                                actual_neighbours.end(),
+                                expected_neighbours.begin(),
+                                expected_neighbours.end());
+
+  tile result = tile(0, 0, 4, 3, 0, 0, 0, 0, -1.0);
+  t.stencil<1>(result, [](const window<double, 1> &w) {
+    std::array<double, 8> neighbours = w.neighbours();
+    double sum = w.center();
+    for (double neighbour : neighbours) {
+      sum += neighbour == -1.0 ? 0.0 : neighbour;
+    }
+    return sum;
+  });
+
+  std::vector<double> expected;
+  t.foreach ([&t, &expected](int y, int x) {
+    double sum = t.get_value(y, x);
+    for (double neighbour : t.get_neighbours(y, x)) {
+      sum += neighbour == -1.0 ? 0.0 : neighbour;
+    }
+    expected.push_back(sum);
+  });
+
+  auto actual = result.to_vector(false);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                expected.begin(), expected.end());
+
+  // a radius-2 window does not fit into single cell margins
+  BOOST_CHECK_THROW(
+      t.stencil<2>(result, [](const window<double, 2> &w) { return w(2, 2); }),
+      std::logic_error);
+
+  gsl_matrix_free(matrix);
+}
+
+BOOST_AUTO_TEST_CASE(TileLayout) {
+  const int ds_width = 20;
+  const int ds_height = 12;
+  gsl_matrix *matrix = create_test_matrix(ds_height, ds_width);
+
+  // 8 + 2 doubles pad to one cache line per row
+  tile t = tile(1, 1, 8, 10, 1, 1, 1, 1, -1.0,
+                construct_reader_callback(matrix));
+  BOOST_CHECK_EQUAL(t.get_stride(), 16);
+
+  for (int y = 0; y < t.get_height(); ++y) {
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(
+                          t.get_row(y).data() - t.get_left_margin()) %
+                          buffer_allocator::alignment,
+                      0);
+  }
+
+  // the GSL view sees the padded buffer, margins included
+  gsl_matrix_view view = t.get_gsl_view();
+  BOOST_CHECK_EQUAL(view.matrix.size1, 12);
+  BOOST_CHECK_EQUAL(view.matrix.size2, 10);
+  BOOST_CHECK_EQUAL(view.matrix.tda, 16);
+
+  for (int i = 0; i < 12; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      BOOST_CHECK_EQUAL(gsl_matrix_get(&view.matrix, i, j),
+                        gsl_matrix_get(matrix, i, j));
+    }
+  }
+
+  // a stride of 1 KiB would map a column onto few cache sets
+  tile wide = tile(0, 0, 128, 2, 0, 0, 0, 0, -1.0);
+  BOOST_CHECK_EQUAL(wide.get_stride(), 136);
+
+  // rows already filling whole cache lines are written without a copy
+  const double *written = nullptr;
+  wide.write([&written](int, int, int, int, const double *buffer) {
+    written = buffer;
+  });
+  BOOST_CHECK(written != wide.get_row(0).data());
+
+  tile packed = tile(0, 0, 24, 2, 0, 0, 0, 0, -1.0);
+  BOOST_CHECK_EQUAL(packed.get_stride(), 24);
+  packed.write([&written](int, int, int, int, const double *buffer) {
+    written = buffer;
+  });
+  BOOST_CHECK(written == packed.get_row(0).data());
+
+  gsl_matrix_free(matrix);
+}
+
+BOOST_AUTO_TEST_CASE(TileView) {
+  const int ds_width = 20;
+  const int ds_height = 12;
+  gsl_matrix *matrix = create_test_matrix(ds_height, ds_width);
+
+  tile t = tile(2, 1, 5, 4, 2, 1, 1, 3, -1.0,
+                construct_reader_callback(matrix));
+
+  tile::view_type interior = t.get_view();
+  BOOST_CHECK_EQUAL(interior.extent(0), 4);
+  BOOST_CHECK_EQUAL(interior.extent(1), 5);
+  BOOST_CHECK_EQUAL(interior.stride(0), t.get_stride());
+  BOOST_CHECK_EQUAL(interior.stride(1), 1);
+  BOOST_CHECK(!interior.is_contiguous());
+
+  // the view reads the buffer in place
+  BOOST_CHECK_EQUAL(interior.data_handle(), t.get_row(0).data());
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      BOOST_CHECK_EQUAL(interior(y, x), t.get_value(y, x));
+    }
+  }
+
+  const tile &ct = t;
+  tile::const_view_type border = ct.get_view(true);
+  BOOST_CHECK_EQUAL(border.extent(0), 8);
+  BOOST_CHECK_EQUAL(border.extent(1), 8);
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 8; ++x) {
+      BOOST_CHECK_EQUAL(border(y, x), gsl_matrix_get(matrix, y, x));
+    }
+  }
+
+  BOOST_CHECK_EQUAL(border.subview(1, 2, 4, 5).data_handle(),
+                    interior.data_handle());
+
+  // writes through the view land in the tile
+  interior(1, 2) = 100;
+  BOOST_CHECK_EQUAL(t.get_value(1, 2), 100);
+
+  std::span<const double> row = border.row(2);
+  BOOST_CHECK_EQUAL(row.size(), 8);
+  BOOST_CHECK_EQUAL(row[4], 100);
+
+  std::vector<double> copy = t.to_vector(false);
+  BOOST_CHECK_EQUAL(copy.size(), 20);
+  BOOST_CHECK_EQUAL(copy[7], 100);
+
+  gsl_matrix_free(matrix);
+}
+
+BOOST_AUTO_TEST_CASE(TileStates) {
+  const double nodata = -1.0;
+  auto constant_reader = [](double value) {
+    return [value](int, int, int width, int height, double *buffer) {
+      std::fill(buffer, buffer + width * height, value);
+    };
+  };
+
+  pool_allocator allocator;
+
+  // an all-nodata tile keeps a single row
+  tile empty = tile(0, 0, 100, 50, 1, 1, 1, 1, nodata,
+                    constant_reader(nodata), &allocator);
+  BOOST_CHECK(empty.get_state() == tile_state::empty);
+  BOOST_CHECK_EQUAL(empty.get_stride(), 0);
+  BOOST_CHECK_EQUAL(allocator.get_stats().current_bytes,
+                    104 * sizeof(double));
+  BOOST_CHECK_EQUAL(empty.count_valid(), 0);
+  BOOST_CHECK_EQUAL(empty.get_value(49, 99), nodata);
+
+  // value kernels mapping the value onto itself leave it compact
+  empty.transform([nodata](double v) { return v == nodata ? v : v + 1; });
+  BOOST_CHECK(empty.get_state() == tile_state::empty);
+
+  int visited = 0;
+  empty.foreach_valid([&visited](int, int, double) { ++visited; });
+  BOOST_CHECK_EQUAL(visited, 0);
+
+  tile uniform =
+      tile(0, 0, 10, 5, 1, 1, 1, 1, nodata, constant_reader(3), &allocator);
+  BOOST_CHECK(uniform.get_state() == tile_state::uniform);
+  BOOST_CHECK_EQUAL(uniform.count_valid(), 50);
+
+  auto copy = std::as_const(uniform).to_vector(true);
+  BOOST_CHECK_EQUAL(copy.size(), 84);
+  BOOST_CHECK(std::all_of(copy.begin(), copy.end(),
+                          [](double v) { return v == 3; }));
+
+  // the rows of a compact tile share one buffer, no const GSL view fits it
+  BOOST_CHECK_THROW(std::as_const(uniform).get_gsl_view(), std::logic_error);
+  BOOST_CHECK(uniform.get_state() == tile_state::uniform);
+
+  // a stencil over a compact tile is evaluated once
+  tile result = tile(0, 0, 10, 5, 0, 0, 0, 0, nodata);
+  int calls = 0;
+  uniform.stencil<1>(result, [&calls](const window<double, 1> &w) {
+    ++calls;
+    return w(-1, -1) + w(1, 1);
+  });
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK_EQUAL(result.get_value(4, 9), 6);
+
+  // writing materializes the full buffer
+  uniform.set_value(2, 3, 7);
+  BOOST_CHECK(uniform.get_state() == tile_state::mixed);
+  BOOST_CHECK(uniform.get_stride() >= 12);
+  BOOST_CHECK_EQUAL(uniform.get_value(2, 3), 7);
+  BOOST_CHECK_EQUAL(uniform.get_value(-1, -1), 3);
+  BOOST_CHECK_EQUAL(uniform.get_value(4, 9), 3);
+
+  // filling the tile back makes it compact again
+  BOOST_CHECK(!uniform.compact());
+  uniform.fill(nodata);
+  BOOST_CHECK(uniform.compact());
+  BOOST_CHECK(uniform.get_state() == tile_state::empty);
+
+  // an exchange of matching cells keeps a compact tile so
+  tile neighbour =
+      tile(10, 0, 10, 5, 1, 1, 1, 1, nodata, constant_reader(nodata));
+  uniform.update_borders(nullptr, nullptr, nullptr, nullptr, &neighbour,
+                         nullptr, nullptr, nullptr);
+  BOOST_CHECK(uniform.get_state() == tile_state::empty);
+
+  neighbour.set_value(2, 0, 5);
+  uniform.update_borders(nullptr, nullptr, nullptr, nullptr, &neighbour,
+                         nullptr, nullptr, nullptr);
+  BOOST_CHECK(uniform.get_state() == tile_state::mixed);
+  BOOST_CHECK_EQUAL(uniform.get_value(2, 10), 5);
+  BOOST_CHECK_EQUAL(uniform.get_value(2, 9), nodata);
+
+  // mixed tiles record which cells are valid
+  tile mixed = tile(0, 0, 70, 3, 0, 0, 0, 0, nodata,
+                    [nodata](int, int, int width, int height, double *buffer) {
+                      for (int i = 0; i < width * height; ++i) {
+                        buffer[i] = i % 3 == 0 ? i : nodata;
+                      }
+                    });
+  BOOST_CHECK(mixed.get_state() == tile_state::mixed);
+  BOOST_CHECK(mixed.has_validity_mask());
+  BOOST_CHECK_EQUAL(mixed.count_valid(), 70);
+  BOOST_CHECK(mixed.is_valid(0, 66));
+  BOOST_CHECK(!mixed.is_valid(0, 67));
+
+  std::vector<double> valid;
+  mixed.foreach_valid([&valid](int y, int x, double v) {
+    BOOST_CHECK_EQUAL(v, y * 70 + x);
+    valid.push_back(v);
+  });
+  BOOST_CHECK_EQUAL(valid.size(), 70);
+
+  mixed.transform([](double v) { return v; });
+  BOOST_CHECK(!mixed.has_validity_mask());
+  BOOST_CHECK_EQUAL(mixed.count_valid(), 70);
+}
+
+namespace {
+
+template <typename T> void check_compression_round_trip(T nodata) {
+  // a smooth surface with a nodata hole and a noisy band
+  auto reader = [nodata](int, int, int width, int height, T *buffer) {
+    unsigned noise = 12345;
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        noise = noise * 1103515245 + 12345;
+        T value = static_cast<T>((x + y) / 3 + 10);
+        if (y > 20 && y < 25) {
+          value = static_cast<T>(noise >> 24);
+        }
+        if (x > 30 && x < 50 && y < 10) {
+          value = nodata;
+        }
+        buffer[y * width + x] = value;
+      }
+    }
+  };
+
+  basic_tile<T> t(0, 0, 70, 40, 1, 1, 1, 1, nodata, reader);
+  const std::vector<T> expected = t.to_vector(true);
+  const std::size_t uncompressed = t.get_memory_bytes();
+
+  t.add_back_buffer();
+  t.compress();
+  BOOST_CHECK(t.is_compressed());
+  BOOST_CHECK(!t.has_buffer());
+
+  // the leading bytes of wider cells vanish, bytes only lose their padding
+  BOOST_CHECK(t.get_memory_bytes() <
+              (sizeof(T) > 1 ? uncompressed / 2 : uncompressed));
+
+  // whole copies and writes decode without decompressing the tile
+  std::vector<T> actual = t.to_vector(true);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                expected.begin(), expected.end());
+
+  std::vector<T> interior = t.to_vector(false);
+  t.write([&interior](int, int, int width, int height, const T *buffer) {
+    BOOST_CHECK(std::equal(buffer, buffer + width * height,
+                           interior.begin()));
+  });
+  BOOST_CHECK(t.is_compressed());
+
+  // visitors and writes decompress the tile
+  std::size_t count = 0;
+  t.foreach ([&count](T) { ++count; });
+  BOOST_CHECK_EQUAL(count, 70 * 40);
+  BOOST_CHECK(!t.is_compressed());
+  BOOST_CHECK(t.has_back_buffer());
+
+  actual = t.to_vector(true);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                expected.begin(), expected.end());
+
+  t.compress();
+  t.set_value(0, 0, nodata);
+  BOOST_CHECK(!t.is_compressed());
+  BOOST_CHECK_EQUAL(t.get_value(0, 0), nodata);
+  BOOST_CHECK_EQUAL(t.get_value(40, 70), expected.back());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(TileCompression) {
+  check_compression_round_trip<std::uint8_t>(255);
+  check_compression_round_trip<std::int16_t>(-9999);
+  check_compression_round_trip<std::uint32_t>(0);
+  check_compression_round_trip<float>(-1.0f);
+  check_compression_round_trip<double>(-1.0);
+
+  // compact tiles are already as small as they get
+  tile empty = tile(0, 0, 10, 10, 0, 0, 0, 0, -1.0,
+                    [](int, int, int width, int height, double *buffer) {
+                      std::fill(buffer, buffer + width * height, -1.0);
+                    });
+  empty.compress();
+  BOOST_CHECK(!empty.is_compressed());
+  BOOST_CHECK(empty.get_state() == tile_state::empty);
+}
+
+BOOST_AUTO_TEST_CASE(TileCompressedConstAccess) {
+  const int size = 64;
+  auto cell = [](int x, int y) {
+    return (x * 7 + y * 13) % 11 == 0 ? -1.0f
+                                      : static_cast<float>(x * y % 97);
+  };
+  auto reader = [&cell](int x, int y, int width, int height, float *buffer) {
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        buffer[i * width + j] = cell(x + j, y + i);
+      }
+    }
+  };
+
+  basic_tile<float> t(1, 1, size, size, 1, 1, 1, 1, -1.0f, reader);
+  const basic_tile<float> &c = t;
+
+  // every const accessor decompresses the tile rather than reading a
+  // buffer that is gone
+
+  auto compressed = [&t]() {
+    t.compress();
+    BOOST_REQUIRE(t.is_compressed());
+    return true;
+  };
+
+  compressed();
+  BOOST_CHECK_EQUAL(c.get_value(3, 3), cell(4, 4));
+  BOOST_CHECK(!t.is_compressed());
+
+  compressed();
+  BOOST_CHECK_EQUAL(c.get_value(std::make_pair(5, 2)), cell(3, 6));
+
+  compressed();
+  const std::span<const float> row = c.get_row(7);
+  BOOST_CHECK_EQUAL(row[9], cell(10, 8));
+
+  compressed();
+  BOOST_CHECK_EQUAL(c.get_view()(2, 3), cell(4, 3));
+
+  compressed();
+  BOOST_CHECK_EQUAL(c.get_view(true)(0, 0), cell(0, 0));
+
+  compressed();
+  BOOST_CHECK_EQUAL(c.get_neighbours(3, 3)[0], cell(3, 3));
+  compressed();
+  BOOST_CHECK_EQUAL(c.get_neighbours(std::make_pair(3, 3))[4], cell(5, 5));
+
+  std::size_t expected_valid = 0;
+  for (int y = 1; y <= size; ++y) {
+    for (int x = 1; x <= size; ++x) {
+      expected_valid += cell(x, y) != -1.0f ? 1 : 0;
+    }
+  }
+
+  compressed();
+  BOOST_CHECK_EQUAL(c.is_valid(10, 10), cell(11, 11) != -1.0f);
+  compressed();
+  BOOST_CHECK_EQUAL(c.count_valid(), expected_valid);
+
+  compressed();
+  std::size_t visited = 0;
+  c.foreach_valid([&](int y, int x, float v) {
+    visited += v == cell(x + 1, y + 1) ? 1 : 0;
+  });
+  BOOST_CHECK_EQUAL(visited, expected_valid);
+
+  compressed();
+  basic_tile<float> result(1, 1, size, size, 0, 0, 0, 0, -1.0f);
+  c.stencil<1>(result,
+               [](const window<float, 1> &w) { return w(-1, -1); });
+  BOOST_CHECK_EQUAL(result.get_value(3, 3), cell(3, 3));
+
+  compressed();
+  const gsl_matrix_float_const_view gsl_view = c.get_gsl_view();
+  BOOST_CHECK_EQUAL(gsl_matrix_float_get(&gsl_view.matrix, 1, 1), cell(1, 1));
+
+  // threads reading a compressed tile at once decode it once
+  compressed();
+  std::vector<std::thread> readers;
+  std::atomic<int> matches{0};
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&c, &cell, &matches, i]() {
+      matches += c.get_value(i, i) == cell(i + 1, i + 1) ? 1 : 0;
+    });
+  }
+  for (std::thread &reader_thread : readers) {
+    reader_thread.join();
+  }
+  BOOST_CHECK_EQUAL(matches.load(), 4);
+  BOOST_CHECK(!t.is_compressed());
+
+  // a copy taken while another thread decodes the tile sees every cell
+  std::vector<float> expected;
+  for (int y = 1; y <= size; ++y) {
+    for (int x = 1; x <= size; ++x) {
+      expected.push_back(cell(x, y));
+    }
+  }
+  for (int round = 0; round < 8; ++round) {
+    compressed();
+    std::vector<float> copied;
+    std::thread copier([&c, &copied]() { copied = c.to_vector(false); });
+    std::thread getter([&c, &cell, &matches]() {
+      matches += c.get_value(2, 2) == cell(3, 3) ? 1 : 0;
+    });
+    copier.join();
+    getter.join();
+    BOOST_CHECK(copied == expected);
+  }
+  BOOST_CHECK_EQUAL(matches.load(), 12);
+}
+
+template <typename T> void check_statistics(T nodata) {
+  const int width = 37;
+  const int height = 9;
+
+  // the margins read from outside the interior hold values too
+  auto cell = [nodata](int x, int y) {
+    const int i = (y + 1) * 64 + x + 1;
+    return i % 5 == 0 ? nodata : static_cast<T>(i % 100 + 1);
+  };
+
+  basic_tile<T> t(0, 0, width, height, 1, 1, 1, 1, nodata,
+                  [&cell](int x, int y, int w, int h, T *buffer) {
+                    for (int i = 0; i < h; ++i) {
+                      for (int j = 0; j < w; ++j) {
+                        buffer[i * w + j] = cell(x + j, y + i);
+                      }
+                    }
+                  });
+
+  tile_statistics<T> expected;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const T v = cell(x, y);
+      if (v == nodata) {
+        ++expected.nodata_count;
+      } else {
+        ++expected.count;
+        expected.min = std::min(expected.min, v);
+        expected.max = std::max(expected.max, v);
+        expected.sum += v;
+      }
+    }
+  }
+
+  auto check = [](const tile_statistics<T> &actual,
+                  const tile_statistics<T> &expected) {
+    BOOST_CHECK_EQUAL(actual.count, expected.count);
+    BOOST_CHECK_EQUAL(actual.nodata_count, expected.nodata_count);
+    BOOST_CHECK_EQUAL(actual.min, expected.min);
+    BOOST_CHECK_EQUAL(actual.max, expected.max);
+    BOOST_CHECK_EQUAL(actual.sum, expected.sum);
+  };
+
+  check(std::as_const(t).get_statistics(), expected);
+
+  // written cells invalidate the statistics
+  BOOST_REQUIRE(cell(3, 4) != nodata);
+  t.set_value(4, 3, static_cast<T>(120));
+  expected.sum += 120 - static_cast<double>(cell(3, 4));
+  expected.max = 120;
+
+  // compressed tiles are summarized without being decompressed
+  t.compress();
+  check(std::as_const(t).get_statistics(), expected);
+  BOOST_CHECK(t.is_compressed());
+
+  t.transform([](T v) { return v; });
+  check(t.get_statistics(), expected);
+}
+
+BOOST_AUTO_TEST_CASE(TileStatistics) {
+  check_statistics<std::uint8_t>(255);
+  check_statistics<std::int16_t>(-9999);
+  check_statistics<std::uint32_t>(0);
+  check_statistics<float>(-1.0f);
+  check_statistics<double>(-1.0);
+
+  auto constant_reader = [](double value) {
+    return [value](int, int, int width, int height, double *buffer) {
+      std::fill(buffer, buffer + width * height, value);
+    };
+  };
+
+  tile empty = tile(0, 0, 10, 5, 0, 0, 0, 0, -1.0, constant_reader(-1));
+  BOOST_CHECK_EQUAL(empty.get_statistics().count, 0);
+  BOOST_CHECK_EQUAL(empty.get_statistics().nodata_count, 50);
+  BOOST_CHECK_EQUAL(empty.get_statistics().mean(), 0);
+
+  tile uniform = tile(0, 0, 10, 5, 0, 0, 0, 0, -1.0, constant_reader(2.5));
+  BOOST_CHECK_EQUAL(uniform.get_statistics().count, 50);
+  BOOST_CHECK_EQUAL(uniform.get_statistics().min, 2.5);
+  BOOST_CHECK_EQUAL(uniform.get_statistics().max, 2.5);
+  BOOST_CHECK_EQUAL(uniform.get_statistics().mean(), 2.5);
+
+  uniform.fill(-1);
+  BOOST_CHECK_EQUAL(uniform.get_statistics().count, 0);
+  BOOST_CHECK_EQUAL(uniform.get_statistics().nodata_count, 50);
+}